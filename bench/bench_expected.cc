@@ -0,0 +1,341 @@
+// Benchmarks for backport::expected, compared with std::expected (C++23),
+// error codes and exceptions.
+//
+// Benchmark names have the form <operation>/<mechanism>/<T>,<E>[/<n>].
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <backport/collect.h>
+#include <backport/expected.h>
+
+#if __has_include(<expected>)
+#include <expected>
+#endif
+
+#if defined(__cpp_lib_expected)
+#define BENCH_STD_EXPECTED 1
+#else
+#define BENCH_STD_EXPECTED 0
+#endif
+
+// and_then and transform arrive in std::expected with 202211L
+#if defined(__cpp_lib_expected) && __cpp_lib_expected>=202211L
+#define BENCH_STD_EXPECTED_MONADIC 1
+#else
+#define BENCH_STD_EXPECTED_MONADIC 0
+#endif
+
+#define BENCH_NOINLINE __attribute__((noinline))
+
+namespace {
+
+// value and error size classes
+
+struct blob64 {
+    std::array<char, 64> bytes{};
+    blob64() = default;
+    explicit blob64(int n) { bytes[0] = char(n); }
+    int get() const { return bytes[0]; }
+};
+
+struct small_error {
+    int code = 0;
+    small_error() = default;
+    explicit small_error(int n): code(n) {}
+};
+
+struct large_error {
+    std::array<char, 48> what{};
+    int code = 0;
+    large_error() = default;
+    explicit large_error(int n): code(n) {}
+};
+
+template <typename X> X make(int n);
+template <> int make<int>(int n) { return n; }
+template <> blob64 make<blob64>(int n) { return blob64(n); }
+template <> std::string make<std::string>(int n) { return std::string(40, char('a'+n%26)); }
+template <> small_error make<small_error>(int n) { return small_error(n); }
+template <> large_error make<large_error>(int n) { return large_error(n); }
+
+int get(int x) { return x; }
+int get(const blob64& x) { return x.get(); }
+int get(const std::string& x) { return int(x.size()); }
+
+// error handling mechanisms
+
+struct bp {
+    static constexpr const char* name = "backport";
+    static constexpr bool monadic = true;
+
+    template <typename T, typename E>
+    using type = backport::expected<T, E>;
+
+    template <typename E>
+    static auto fail(E&& e) { return backport::unexpected<std::decay_t<E>>(std::forward<E>(e)); }
+};
+
+#if BENCH_STD_EXPECTED
+struct stdx {
+    static constexpr const char* name = "std";
+    static constexpr bool monadic = BENCH_STD_EXPECTED_MONADIC;
+
+    template <typename T, typename E>
+    using type = std::expected<T, E>;
+
+    template <typename E>
+    static auto fail(E&& e) { return std::unexpected<std::decay_t<E>>(std::forward<E>(e)); }
+};
+#endif
+
+template <typename E>
+struct exception_of: std::exception {
+    E error;
+    explicit exception_of(E e): error(std::move(e)) {}
+};
+
+// construction, copy, move, value()
+
+template <typename M, typename T, typename E>
+void construct_value(benchmark::State& state) {
+    int n = 0;
+    for (auto _: state) {
+        typename M::template type<T, E> x(make<T>(n++));
+        benchmark::DoNotOptimize(x);
+    }
+}
+
+template <typename M, typename T, typename E>
+void construct_error(benchmark::State& state) {
+    int n = 0;
+    for (auto _: state) {
+        typename M::template type<T, E> x(M::fail(make<E>(n++)));
+        benchmark::DoNotOptimize(x);
+    }
+}
+
+template <typename M, typename T, typename E>
+void copy(benchmark::State& state) {
+    typename M::template type<T, E> x(make<T>(1));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(x);
+        auto y = x;
+        benchmark::DoNotOptimize(y);
+    }
+}
+
+template <typename M, typename T, typename E>
+void move(benchmark::State& state) {
+    typename M::template type<T, E> x(make<T>(1));
+    for (auto _: state) {
+        auto y = std::move(x);
+        benchmark::DoNotOptimize(y);
+        x = std::move(y);
+        benchmark::ClobberMemory();
+    }
+}
+
+template <typename M, typename T, typename E>
+void value(benchmark::State& state) {
+    typename M::template type<T, E> x(make<T>(1));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(x);
+        benchmark::DoNotOptimize(get(x.value()));
+    }
+}
+
+// monadic chains of depth state.range(0); every step succeeds
+
+template <typename M, typename T, typename E>
+void and_then_chain(benchmark::State& state) {
+    using ex = typename M::template type<T, E>;
+    auto step = [](T t) -> ex { return make<T>(get(t)+1); };
+    const int depth = state.range(0);
+
+    for (auto _: state) {
+        ex x(make<T>(0));
+        for (int i = 0; i<depth; ++i) x = std::move(x).and_then(step);
+        benchmark::DoNotOptimize(x);
+    }
+}
+
+template <typename M, typename T, typename E>
+void transform_chain(benchmark::State& state) {
+    using ex = typename M::template type<T, E>;
+    auto step = [](T t) { return make<T>(get(t)+1); };
+    const int depth = state.range(0);
+
+    for (auto _: state) {
+        ex x(make<T>(0));
+        for (int i = 0; i<depth; ++i) x = std::move(x).transform(step);
+        benchmark::DoNotOptimize(x);
+    }
+}
+
+// Propagation through state.range(0) stack frames, with the error (when
+// failing) created in the innermost frame.
+
+template <typename M, typename T, typename E>
+BENCH_NOINLINE typename M::template type<T, E> propagate(int depth, bool fail) {
+    if (!depth) {
+        if (fail) return M::fail(make<E>(depth));
+        return make<T>(depth);
+    }
+    auto r = propagate<M, T, E>(depth-1, fail);
+    if (!r) return M::fail(std::move(r).error());
+    return r;
+}
+
+struct error_code {
+    static constexpr const char* name = "error_code";
+};
+
+template <typename T, typename E>
+BENCH_NOINLINE int propagate_code(int depth, bool fail, T& out) {
+    if (!depth) {
+        if (fail) return 1;
+        out = make<T>(depth);
+        return 0;
+    }
+    if (int ec = propagate_code<T, E>(depth-1, fail, out)) return ec;
+    return 0;
+}
+
+struct exceptions {
+    static constexpr const char* name = "exception";
+};
+
+template <typename T, typename E>
+BENCH_NOINLINE T propagate_throw(int depth, bool fail) {
+    if (!depth) {
+        if (fail) throw exception_of<E>(make<E>(depth));
+        return make<T>(depth);
+    }
+    T r = propagate_throw<T, E>(depth-1, fail);
+    benchmark::DoNotOptimize(r);
+    return r;
+}
+
+template <typename M, typename T, typename E, bool Fail>
+void propagation(benchmark::State& state) {
+    const int depth = state.range(0);
+    for (auto _: state) {
+        if constexpr (std::is_same_v<M, error_code>) {
+            T out{};
+            int ec = propagate_code<T, E>(depth, Fail, out);
+            benchmark::DoNotOptimize(ec);
+            benchmark::DoNotOptimize(out);
+        }
+        else if constexpr (std::is_same_v<M, exceptions>) {
+            try {
+                T r = propagate_throw<T, E>(depth, Fail);
+                benchmark::DoNotOptimize(r);
+            }
+            catch (exception_of<E>& e) {
+                benchmark::DoNotOptimize(e.error);
+            }
+        }
+        else {
+            auto r = propagate<M, T, E>(depth, Fail);
+            benchmark::DoNotOptimize(r);
+        }
+    }
+}
+
+// collect over state.range(0) elements with a cheap function, evaluated
+// sequentially, or with threads started whatever the size of the range (a
+// grain of one element): the threaded evaluation is faster only from the size
+// at which its time falls below the sequential time.
+
+template <bool Threads>
+void collect_range(benchmark::State& state) {
+    std::vector<int> ns(state.range(0));
+    for (std::size_t i = 0; i<ns.size(); ++i) ns[i] = int(i);
+
+    auto f = [](int i) -> backport::expected<int, small_error> {
+        if (i<0) return backport::unexpected(small_error(i));
+        return 3*i+1;
+    };
+
+    for (auto _: state) {
+        if constexpr (Threads) {
+            auto r = backport::detail::collect_parallel(ns.begin(), ns.end(), f, 1);
+            benchmark::DoNotOptimize(r);
+        }
+        else {
+            auto r = backport::collect(ns.begin(), ns.end(), f);
+            benchmark::DoNotOptimize(r);
+        }
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+// registration
+
+template <typename T> const char* type_name();
+template <> const char* type_name<int>() { return "int"; }
+template <> const char* type_name<blob64>() { return "blob64"; }
+template <> const char* type_name<std::string>() { return "string"; }
+template <> const char* type_name<small_error>() { return "small_error"; }
+template <> const char* type_name<large_error>() { return "large_error"; }
+
+template <typename M, typename T, typename E>
+std::string bench_name(const char* op) {
+    return std::string(op)+"/"+M::name+"/"+type_name<T>()+","+type_name<E>();
+}
+
+template <typename M, typename T, typename E>
+void register_expected() {
+    benchmark::RegisterBenchmark(bench_name<M, T, E>("construct_value").c_str(), construct_value<M, T, E>);
+    benchmark::RegisterBenchmark(bench_name<M, T, E>("construct_error").c_str(), construct_error<M, T, E>);
+    benchmark::RegisterBenchmark(bench_name<M, T, E>("copy").c_str(), copy<M, T, E>);
+    benchmark::RegisterBenchmark(bench_name<M, T, E>("move").c_str(), move<M, T, E>);
+    benchmark::RegisterBenchmark(bench_name<M, T, E>("value").c_str(), value<M, T, E>);
+    if constexpr (M::monadic) {
+        benchmark::RegisterBenchmark(bench_name<M, T, E>("and_then").c_str(), and_then_chain<M, T, E>)->Arg(1)->Arg(4)->Arg(16);
+        benchmark::RegisterBenchmark(bench_name<M, T, E>("transform").c_str(), transform_chain<M, T, E>)->Arg(1)->Arg(4)->Arg(16);
+    }
+}
+
+template <typename M, typename T, typename E>
+void register_propagation() {
+    benchmark::RegisterBenchmark(bench_name<M, T, E>("propagate_value").c_str(), propagation<M, T, E, false>)->Arg(1)->Arg(8)->Arg(32);
+    benchmark::RegisterBenchmark(bench_name<M, T, E>("propagate_error").c_str(), propagation<M, T, E, true>)->Arg(1)->Arg(8)->Arg(32);
+}
+
+template <typename T, typename E>
+void register_size_class() {
+    register_expected<bp, T, E>();
+    register_propagation<bp, T, E>();
+#if BENCH_STD_EXPECTED
+    register_expected<stdx, T, E>();
+    register_propagation<stdx, T, E>();
+#endif
+    register_propagation<error_code, T, E>();
+    register_propagation<exceptions, T, E>();
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    register_size_class<int, small_error>();
+    register_size_class<int, large_error>();
+    register_size_class<blob64, small_error>();
+    register_size_class<std::string, std::string>();
+
+    benchmark::RegisterBenchmark("collect/sequential/int,small_error", collect_range<false>)
+        ->RangeMultiplier(4)->Range(1<<10, 1<<20)->UseRealTime();
+    benchmark::RegisterBenchmark("collect/threads/int,small_error", collect_range<true>)
+        ->RangeMultiplier(4)->Range(1<<10, 1<<20)->UseRealTime();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Compare Google Benchmark JSON results against a baseline.
+
+usage: compare.py BASELINE RESULTS [--threshold RATIO]
+
+Prints each benchmark present in both files with the ratio of its time to
+the baseline, and exits with status 1 if any ratio exceeds the threshold
+(default 1.10).
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+
+    times = {}
+    for b in data.get('benchmarks', []):
+        # skip aggregates other than the mean when run with repetitions
+        if b.get('run_type') == 'aggregate' and b.get('aggregate_name') != 'mean':
+            continue
+        times[b['run_name'] if 'run_name' in b else b['name']] = b['real_time']
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser(description='flag benchmark regressions against a baseline')
+    parser.add_argument('baseline')
+    parser.add_argument('results')
+    parser.add_argument('--threshold', type=float, default=1.10,
+                        help='largest accepted ratio of time to baseline time (default 1.10)')
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cur = load(args.results)
+
+    regressions = []
+    width = max((len(name) for name in cur), default=0)
+    for name, t in cur.items():
+        if name not in base or base[name] <= 0:
+            continue
+        ratio = t/base[name]
+        flag = ''
+        if ratio > args.threshold:
+            flag = '  REGRESSION'
+            regressions.append(name)
+        print(f'{name:<{width}}  {base[name]:12.2f}  {t:12.2f}  {ratio:6.3f}{flag}')
+
+    missing = sorted(set(base)-set(cur))
+    for name in missing:
+        print(f'{name:<{width}}  missing from results')
+
+    if regressions:
+        print(f'{len(regressions)} regression(s) above {args.threshold:.2f}x baseline', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
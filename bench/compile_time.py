@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Measure the compile-time cost of instantiating many expected types.
+
+usage: compile_time.py [--cxx CXX] [--std STD] [--count N] [--flag FLAG ...]
+                       [--config NAME=FLAGS ...]
+
+Generates a translation unit that instantiates --count distinct
+expected<T, E> types, each with value, error and converting constructors and
+a chain of monadic operations, and compiles it with -fsyntax-only once for
+each configuration, reporting the frontend time and peak memory use of the
+compiler. Each configuration adds its space-separated FLAGS to the command
+line; without any --config, a single configuration 'default' is used.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+PRELUDE = '''\
+#include <backport/expected.h>
+
+using backport::expected;
+using backport::unexpected;
+
+template <int I> struct value { int x; };
+template <int I> struct error { int code; };
+
+template <int I>
+expected<value<I>, error<I>> f(int n) {
+    using ex = expected<value<I>, error<I>>;
+
+    ex a(value<I>{n});
+    auto b = a.and_then([](value<I> v) -> ex { return v; })
+              .transform([](value<I> v) { return long(v.x); })
+              .or_else([](error<I> e) -> expected<long, error<I>> { return unexpected(e); })
+              .transform_error([](error<I> e) { return e.code; });
+
+    expected<long long, int> c(b);
+    expected<void, error<I>> d;
+    if (!c) return unexpected(error<I>{c.error()});
+    if (!d) return unexpected(d.error());
+    return a;
+}
+
+'''
+
+
+def generate(count):
+    lines = [PRELUDE]
+    for i in range(count):
+        lines.append(f'template expected<value<{i}>, error<{i}>> f<{i}>(int);\n')
+    return ''.join(lines)
+
+
+def measure(cmd):
+    """Run cmd; return wall time in seconds and peak resident set in KiB."""
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd)
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter()-start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    if proc.returncode:
+        raise subprocess.CalledProcessError(proc.returncode, cmd)
+    return elapsed, usage.ru_maxrss
+
+
+def main():
+    parser = argparse.ArgumentParser(description='measure compile time of expected instantiations')
+    parser.add_argument('--cxx', default=os.environ.get('CXX', 'c++'))
+    parser.add_argument('--std', default='c++17')
+    parser.add_argument('--count', type=int, default=2000, help='number of distinct expected types (default 2000)')
+    parser.add_argument('--flag', action='append', default=[], help='additional compiler flag')
+    parser.add_argument('--config', action='append', default=[], help='NAME=FLAGS configuration to measure')
+    args = parser.parse_args()
+
+    configs = []
+    for c in args.config or ['default=']:
+        name, _, flags = c.partition('=')
+        configs.append((name, flags.split()))
+
+    with tempfile.TemporaryDirectory() as tmp:
+        src = os.path.join(tmp, 'instantiate.cc')
+        with open(src, 'w') as f:
+            f.write(generate(args.count))
+
+        print(f'{"config":<12} {"std":<7} {"types":>6} {"time (s)":>9} {"peak (MiB)":>11}')
+        for name, flags in configs:
+            cmd = [args.cxx, f'-std={args.std}', '-fsyntax-only', *args.flag, *flags, src]
+            elapsed, rss = measure(cmd)
+            print(f'{name:<12} {args.std:<7} {args.count:>6} {elapsed:>9.2f} {rss/1024:>11.1f}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
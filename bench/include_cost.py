@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Compare the cost of making expected available to many translation units.
+
+usage: include_cost.py [--cxx CXX] [--std STD] [--count N] [--flag FLAG ...]
+                       [--module SOURCE]
+
+Generates --count translation units that use expected only in function
+signatures, passing it through by reference or pointer, and compiles all of
+them with -fsyntax-only for each of the ways of obtaining the declarations:
+
+    expected.h      #include <backport/expected.h>
+    expected_fwd.h  #include <backport/expected_fwd.h>
+    module          import backport.expected; (only with --module, which gives
+                    the module interface unit; requires -fmodules-ts support,
+                    and C++20 or later)
+
+and reports the total time and the largest peak memory use of the compiler.
+For the module, the time to build the module interface is reported
+separately.
+
+The module interface re-exports the header with using-declarations, which
+GCC supports from version 15; the Makefile passes --module only for such a
+compiler.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+TU = '''\
+{prelude}
+
+namespace tu{i} {{
+
+struct error {{ int code; }};
+struct value {{ int x, y; }};
+
+backport::expected<value, error>& lookup(int key);
+backport::expected<int, error>* find(const char* name);
+void report(const backport::expected<int, error>& status);
+
+const backport::expected<value, error>& lookup_twice(int key) {{
+    lookup(key);
+    return lookup(key);
+}}
+
+void forward(const backport::expected<int, error>* status) {{
+    report(*status);
+}}
+
+}} // namespace tu{i}
+'''
+
+PRELUDES = {
+    'expected.h': '#include <backport/expected.h>',
+    'expected_fwd.h': '#include <backport/expected_fwd.h>',
+    'module': 'import backport.expected;',
+}
+
+
+def run(cmd, cwd):
+    """Run cmd; return wall time in seconds and peak resident set in KiB."""
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, cwd=cwd)
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter()-start
+    code = os.waitstatus_to_exitcode(status)
+    if code:
+        raise subprocess.CalledProcessError(code, cmd)
+    return elapsed, usage.ru_maxrss
+
+
+def main():
+    parser = argparse.ArgumentParser(description='compare include costs of expected.h, expected_fwd.h and the module')
+    parser.add_argument('--cxx', default=os.environ.get('CXX', 'c++'))
+    parser.add_argument('--std', default='c++17')
+    parser.add_argument('--count', type=int, default=200, help='number of translation units (default 200)')
+    parser.add_argument('--flag', action='append', default=[], help='additional compiler flag')
+    parser.add_argument('--module', help='module interface unit for backport.expected')
+    args = parser.parse_args()
+
+    base = [args.cxx, f'-std={args.std}', *args.flag]
+    variants = ['expected.h', 'expected_fwd.h']
+    if args.module:
+        variants.append('module')
+
+    with tempfile.TemporaryDirectory() as tmp:
+        print(f'{"declarations":<15} {"std":<7} {"TUs":>5} {"time (s)":>9} {"per TU (ms)":>12} {"peak (MiB)":>11}')
+
+        for variant in variants:
+            flags = []
+            if variant == 'module':
+                flags = ['-fmodules-ts']
+                elapsed, rss = run([*base, *flags, '-x', 'c++', '-c', '-o', 'module.o', os.path.abspath(args.module)], tmp)
+                print(f'{"(module build)":<15} {args.std:<7} {1:>5} {elapsed:>9.2f} {elapsed*1000:>12.1f} {rss/1024:>11.1f}')
+
+            total, peak = 0.0, 0
+            for i in range(args.count):
+                src = os.path.join(tmp, f'tu{i}.cc')
+                with open(src, 'w') as f:
+                    f.write(TU.format(prelude=PRELUDES[variant], i=i))
+                elapsed, rss = run([*base, *flags, '-fsyntax-only', src], tmp)
+                total += elapsed
+                peak = max(peak, rss)
+            print(f'{variant:<15} {args.std:<7} {args.count:>5} {total:>9.2f} {total*1000/args.count:>12.1f} {peak/1024:>11.1f}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,267 @@
+#pragma once
+
+// Collect a range of expected<T, E> into expected<std::vector<T>, E>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <execution>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <backport/expected.h>
+
+// Parallel collect uses one thread, the calling thread included, for every
+// BACKPORT_EXPECTED_COLLECT_GRAIN elements, up to hardware_concurrency(), and
+// is sequential if the range would not occupy two. Starting and joining a
+// thread costs some tens of microseconds, the time taken to evaluate tens of
+// thousands of elements by a cheap function; with a more expensive function,
+// a smaller grain pays off. The collect benchmarks of bench-expected show
+// the crossover. Like the other configuration macros, it must be defined
+// consistently across translation units.
+
+#ifndef BACKPORT_EXPECTED_COLLECT_GRAIN
+#define BACKPORT_EXPECTED_COLLECT_GRAIN 32768
+#endif
+
+namespace backport {
+
+namespace detail {
+
+struct collect_identity {
+    template <typename X>
+    constexpr X&& operator()(X&& x) const noexcept { return std::forward<X>(x); }
+};
+
+template <typename It, typename F>
+using collect_result_t = std::remove_cv_t<std::remove_reference_t<
+    std::invoke_result_t<F&, typename std::iterator_traits<It>::reference>>>;
+
+template <typename It, typename F>
+struct collect_types {
+    using R = collect_result_t<It, F>;
+    static_assert(is_expected_v<R>, "collect requires a range of expected or a function returning expected");
+
+    using value_type = std::remove_cv_t<typename R::value_type>;
+    using error_type = typename R::error_type;
+    static_assert(std::is_object_v<value_type>, "collect requires an object value type");
+
+    using result_type = expected<std::vector<value_type>, error_type>;
+};
+
+// Shared state for one collect: elements are written to out; the failure
+// (error or exception) of the lowest-indexed failing element seen so far is
+// kept in err or exc, and its index in err_index. Work on elements beyond
+// err_index is abandoned.
+//
+// Each slot of out must be a separate memory location, as slots are written
+// concurrently: bool values are kept in bytes rather than in the packed bits
+// of a std::vector<bool>.
+
+template <typename T, typename E>
+struct collect_state {
+    explicit collect_state(std::size_t n): out(n), err_index(n) {}
+
+    using slot_type = std::conditional_t<
+        std::is_same_v<T, bool>,
+        unsigned char,
+        std::conditional_t<std::is_default_constructible_v<T>, T, std::optional<T>>>;
+    std::vector<slot_type> out;
+
+    std::atomic<std::size_t> err_index;
+    std::mutex mex;
+    std::optional<E> err;
+    std::exception_ptr exc;
+
+    template <typename G>
+    void publish_error(std::size_t i, G&& g) {
+        std::lock_guard<std::mutex> lock(mex);
+        if (i<err_index.load(std::memory_order_relaxed)) {
+            err.emplace(std::forward<G>(g));
+            exc = nullptr;
+            err_index.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    void publish_exception(std::size_t i) {
+        std::lock_guard<std::mutex> lock(mex);
+        if (i<err_index.load(std::memory_order_relaxed)) {
+            exc = std::current_exception();
+            err.reset();
+            err_index.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename It, typename F>
+    void run(It first, F& f, std::size_t b, std::size_t e) {
+        std::size_t i = b;
+        BACKPORT_EXPECTED_TRY {
+            for (; i<e; ++i) {
+                if (i>=err_index.load(std::memory_order_relaxed)) return;
+
+                auto&& r = detail::invoke(f, first[i]);
+                if (r.has_value()) out[i] = *std::forward<decltype(r)>(r);
+                else publish_error(i, std::forward<decltype(r)>(r).error());
+            }
+        }
+        BACKPORT_EXPECTED_CATCH_ALL {
+            publish_exception(i);
+        }
+    }
+
+    template <typename R>
+    R result() {
+        if (exc) std::rethrow_exception(exc);
+        if (err) return R(unexpect, std::move(*err));
+
+        if constexpr (std::is_same_v<slot_type, T>) {
+            return R(std::in_place, std::move(out));
+        }
+        else {
+            std::vector<T> v;
+            v.reserve(out.size());
+            for (auto& x: out) {
+                if constexpr (std::is_same_v<T, bool>) v.push_back(x!=0);
+                else v.push_back(std::move(*x));
+            }
+            return R(std::in_place, std::move(v));
+        }
+    }
+};
+
+template <typename It, typename F>
+auto collect_sequential(It first, It last, F& f) {
+    using types = collect_types<It, F>;
+    using R = typename types::result_type;
+
+    std::vector<typename types::value_type> out;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>) {
+        out.reserve(std::distance(first, last));
+    }
+
+    for (; first!=last; ++first) {
+        auto&& r = detail::invoke(f, *first);
+        if (!r.has_value()) return R(unexpect, std::forward<decltype(r)>(r).error());
+        out.push_back(*std::forward<decltype(r)>(r));
+    }
+    return R(std::in_place, std::move(out));
+}
+
+// Elements are divided into chunks, claimed in order from a shared counter by
+// the calling thread and up to hardware_concurrency()-1 helper threads, so
+// that faster threads take on more chunks. There is one thread for every
+// grain elements.
+
+template <typename It, typename F>
+auto collect_parallel(It first, It last, F& f, std::size_t grain = BACKPORT_EXPECTED_COLLECT_GRAIN) {
+    using types = collect_types<It, F>;
+    using R = typename types::result_type;
+
+    // hardware_concurrency() may query the system on each call
+    static const std::size_t n_core = std::max(1u, std::thread::hardware_concurrency());
+
+    std::size_t n = std::distance(first, last);
+    std::size_t n_thread = std::min(n_core, n/std::max<std::size_t>(grain, 1));
+    constexpr std::size_t min_chunk = 256;
+
+    if (n_thread<=1 || n<=min_chunk) return collect_sequential(first, last, f);
+
+    std::size_t chunk = std::max(min_chunk, n/(8*n_thread));
+    std::size_t n_chunk = (n+chunk-1)/chunk;
+    n_thread = std::min(n_thread, n_chunk);
+
+    collect_state<typename types::value_type, typename types::error_type> state(n);
+    std::atomic<std::size_t> next{0};
+
+    auto work = [&] {
+        for (;;) {
+            std::size_t c = next.fetch_add(1, std::memory_order_relaxed);
+            if (c>=n_chunk) return;
+
+            std::size_t b = c*chunk;
+            if (b>=state.err_index.load(std::memory_order_relaxed)) return;
+            state.run(first, f, b, std::min(n, b+chunk));
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    helpers.reserve(n_thread-1);
+    BACKPORT_EXPECTED_TRY {
+        for (std::size_t i = 1; i<n_thread; ++i) helpers.emplace_back(work);
+    }
+    BACKPORT_EXPECTED_CATCH_ALL {
+        // run with however many threads could be started
+    }
+    work();
+    for (auto& t: helpers) t.join();
+
+    return state.template result<R>();
+}
+
+} // namespace detail
+
+// collect(first, last) and collect(first, last, f)
+//
+// Convert a range of expected<T, E>, or the results of applying f to each
+// element of a range, into expected<std::vector<T>, E>: the vector of values
+// if every element has one, or else the error of the first element that does
+// not. Elements after the first error are not evaluated.
+
+template <typename It, typename F>
+auto collect(It first, It last, F f) {
+    return detail::collect_sequential(first, last, f);
+}
+
+template <typename It>
+auto collect(It first, It last) {
+    return collect(first, last, detail::collect_identity{});
+}
+
+// collect(policy, first, last) and collect(policy, first, last, f)
+//
+// As above, with a standard execution policy. With the parallel policies,
+// elements are evaluated concurrently in chunks over random access iterators,
+// if there are at least twice BACKPORT_EXPECTED_COLLECT_GRAIN of them;
+// the result is the same as for sequential evaluation, and once an error is
+// found, evaluation of later elements is abandoned. If f throws, the exception
+// is rethrown once all threads have stopped. With seq or unseq, evaluation is
+// sequential.
+
+template <
+    typename ExecutionPolicy,
+    typename It,
+    typename F,
+    std::enable_if_t<std::is_execution_policy_v<std::remove_cv_t<std::remove_reference_t<ExecutionPolicy>>>, int> = 0
+>
+auto collect(ExecutionPolicy&&, It first, It last, F f) {
+    using policy = std::remove_cv_t<std::remove_reference_t<ExecutionPolicy>>;
+    constexpr bool random_access =
+        std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>;
+
+    if constexpr (random_access &&
+                  (std::is_same_v<policy, std::execution::parallel_policy> ||
+                   std::is_same_v<policy, std::execution::parallel_unsequenced_policy>))
+    {
+        return detail::collect_parallel(first, last, f);
+    }
+    else {
+        return detail::collect_sequential(first, last, f);
+    }
+}
+
+template <
+    typename ExecutionPolicy,
+    typename It,
+    std::enable_if_t<std::is_execution_policy_v<std::remove_cv_t<std::remove_reference_t<ExecutionPolicy>>>, int> = 0
+>
+auto collect(ExecutionPolicy&& policy, It first, It last) {
+    return collect(std::forward<ExecutionPolicy>(policy), first, last, detail::collect_identity{});
+}
+
+} // namespace backport
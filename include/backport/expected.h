@@ -2,26 +2,146 @@
 
 // C++17 version of C++23 std::expected
 
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <initializer_list>
+#include <memory>
+#include <new>
 #include <optional>
+#include <system_error>
 #include <type_traits>
 #include <utility>
-#include <variant>
 
-namespace backport {
+#include <backport/expected_fwd.h>
 
-namespace detail {
+#if BACKPORT_EXPECTED_TELEMETRY
+#include <atomic>
+#include <string_view>
+#endif
 
-template <typename V, typename U, std::size_t index = (std::variant_size_v<std::remove_cv_t<std::remove_reference_t<U>>>-1)>
-constexpr V convert_variant(U&& u) {
-    if (u.index()==index) return V{std::in_place_index<index>, std::get<index>(std::forward<U>(u))};
-    if constexpr (index>0) return convert_variant<V, U, index-1>(std::forward<U>(u));
-    else throw std::bad_variant_access{};
-}
+// Contract checking for accessors with a precondition (operator*, operator->,
+// error()); the monadic operations go through these accessors too.
+// Select with BACKPORT_EXPECTED_CONTRACT:
+//   BACKPORT_EXPECTED_CONTRACT_UNCHECKED  no checks;
+//   BACKPORT_EXPECTED_CONTRACT_ASSERT     assert(), compiled out under NDEBUG (default);
+//   BACKPORT_EXPECTED_CONTRACT_TRAP       abnormal termination on violation.
+
+#define BACKPORT_EXPECTED_CONTRACT_UNCHECKED 0
+#define BACKPORT_EXPECTED_CONTRACT_ASSERT 1
+#define BACKPORT_EXPECTED_CONTRACT_TRAP 2
+
+#ifndef BACKPORT_EXPECTED_CONTRACT
+#define BACKPORT_EXPECTED_CONTRACT BACKPORT_EXPECTED_CONTRACT_ASSERT
+#endif
+
+#if BACKPORT_EXPECTED_CONTRACT == BACKPORT_EXPECTED_CONTRACT_TRAP
+#if defined(__GNUC__) || defined(__clang__)
+#define BACKPORT_EXPECTED_PRE(cond) ((cond)? void(0): __builtin_trap())
+#else
+#define BACKPORT_EXPECTED_PRE(cond) ((cond)? void(0): std::abort())
+#endif
+#elif BACKPORT_EXPECTED_CONTRACT == BACKPORT_EXPECTED_CONTRACT_ASSERT
+#define BACKPORT_EXPECTED_PRE(cond) assert(cond)
+#else
+#define BACKPORT_EXPECTED_PRE(cond) ((void)0)
+#endif
+
+// Builds without exceptions
+//
+// BACKPORT_EXPECTED_EXCEPTIONS is 0 if exceptions are disabled. Operations
+// that would throw then instead call a handler that does not return, selected
+// with BACKPORT_EXPECTED_FAILURE:
+//   BACKPORT_EXPECTED_FAILURE_ABORT  std::abort() (default);
+//   BACKPORT_EXPECTED_FAILURE_TRAP   abnormal termination by trap;
+//   BACKPORT_EXPECTED_FAILURE_HOOK   call the handler set by set_failure_handler()
+//                                    with the exception that would have been
+//                                    thrown, and abort if it returns.
+
+#ifndef BACKPORT_EXPECTED_EXCEPTIONS
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define BACKPORT_EXPECTED_EXCEPTIONS 1
+#else
+#define BACKPORT_EXPECTED_EXCEPTIONS 0
+#endif
+#endif
+
+#define BACKPORT_EXPECTED_FAILURE_ABORT 0
+#define BACKPORT_EXPECTED_FAILURE_TRAP 1
+#define BACKPORT_EXPECTED_FAILURE_HOOK 2
+
+#ifndef BACKPORT_EXPECTED_FAILURE
+#define BACKPORT_EXPECTED_FAILURE BACKPORT_EXPECTED_FAILURE_ABORT
+#endif
+
+#if BACKPORT_EXPECTED_EXCEPTIONS
+#define BACKPORT_EXPECTED_TRY try
+#define BACKPORT_EXPECTED_CATCH_ALL catch (...)
+#define BACKPORT_EXPECTED_RETHROW throw
+#else
+#define BACKPORT_EXPECTED_TRY if (true)
+#define BACKPORT_EXPECTED_CATCH_ALL if (false)
+#define BACKPORT_EXPECTED_RETHROW ((void)0)
+#endif
+
+// Error telemetry
+//
+// With BACKPORT_EXPECTED_TELEMETRY defined to 1, construction of an unexpected,
+// construction of an expected holding an error, and transform_error on an
+// error each call the hook set by set_telemetry_hook(). Otherwise (the
+// default) there are no calls. The hooks are not called during constant
+// evaluation. The calls are part of the inline definitions of expected and
+// unexpected, so the macro must be defined consistently across all
+// translation units; mixing the two is an ODR violation, and which
+// definitions the program ends up with is unspecified.
+
+#ifndef BACKPORT_EXPECTED_TELEMETRY
+#define BACKPORT_EXPECTED_TELEMETRY 0
+#endif
+
+#if BACKPORT_EXPECTED_TELEMETRY
+#define BACKPORT_EXPECTED_ERROR_EVENT(E, event) (::backport::detail::error_telemetry<E>(::backport::error_event::event))
+#else
+#define BACKPORT_EXPECTED_ERROR_EVENT(E, event) ((void)0)
+#endif
 
-} // detail
+// Destructors and functions with try blocks can be constexpr only from C++20;
+// construction in place and changing the active member of a union are
+// likewise only constant expressions from C++20.
 
+#if __cplusplus >= 202002L
+#define BACKPORT_CONSTEXPR20 constexpr
+#else
+#define BACKPORT_CONSTEXPR20
+#endif
+
+// Constructors are constrained with requires clauses, and implicit and
+// explicit overloads merged with explicit(bool), where C++20 concepts are
+// available; BACKPORT_EXPECTED_CONCEPTS may be defined to 0 to use the
+// enable_if constraints instead. Under C++23 deducing this, each monadic
+// operation is a single member function. Either must be chosen consistently
+// across translation units.
+
+#ifndef BACKPORT_EXPECTED_CONCEPTS
+#if __cplusplus >= 202002L && defined(__cpp_concepts) && __cpp_concepts >= 201907L && defined(__cpp_conditional_explicit)
+#define BACKPORT_EXPECTED_CONCEPTS 1
+#else
+#define BACKPORT_EXPECTED_CONCEPTS 0
+#endif
+#endif
+
+#ifndef BACKPORT_EXPECTED_DEDUCING_THIS
+#if defined(__cpp_explicit_this_parameter) && __cpp_explicit_this_parameter >= 202110L
+#define BACKPORT_EXPECTED_DEDUCING_THIS 1
+#else
+#define BACKPORT_EXPECTED_DEDUCING_THIS 0
+#endif
+#endif
+
+namespace backport {
 
 // bad_accepted_access exceptions
 
@@ -47,120 +167,1319 @@ private:
     E error_;
 };
 
+// failure handling
+
+using failure_handler = void (*)(const std::exception&);
+
+namespace detail {
+inline failure_handler failure_hook = nullptr;
+}
+
+// Set the handler called in place of throwing when BACKPORT_EXPECTED_FAILURE
+// is BACKPORT_EXPECTED_FAILURE_HOOK; returns the previous handler.
+inline failure_handler set_failure_handler(failure_handler h) noexcept {
+    failure_handler prev = detail::failure_hook;
+    detail::failure_hook = h;
+    return prev;
+}
+
+namespace detail {
+
+template <typename X>
+[[noreturn]] void throw_failure(X&& x) {
+#if BACKPORT_EXPECTED_EXCEPTIONS
+    throw std::forward<X>(x);
+#elif BACKPORT_EXPECTED_FAILURE == BACKPORT_EXPECTED_FAILURE_TRAP
+    (void)x;
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_trap();
+#else
+    std::abort();
+#endif
+#elif BACKPORT_EXPECTED_FAILURE == BACKPORT_EXPECTED_FAILURE_HOOK
+    (void)x;
+    if constexpr (std::is_base_of_v<std::exception, std::remove_reference_t<X>>) {
+        if (failure_hook) failure_hook(x);
+    }
+    std::abort();
+#else
+    (void)x;
+    std::abort();
+#endif
+}
+
+} // namespace detail
+
+#if BACKPORT_EXPECTED_TELEMETRY
+
+// error telemetry hooks
+
+enum class error_event { unexpected, expected, transform_error };
+
+// One error_type_info per error type, with its name and a distinct index
+// counting from zero.
+struct error_type_info {
+    std::string_view name;
+    std::size_t index;
+};
+
+using telemetry_hook = void (*)(error_event, const error_type_info&);
+
+namespace detail {
+
+inline telemetry_hook telemetry_hook_fn = nullptr;
+inline std::atomic<std::size_t> error_type_count{0};
+
+template <typename E>
+constexpr std::string_view error_type_name() noexcept {
+#if defined(__clang__) || defined(__GNUC__)
+    std::string_view f = __PRETTY_FUNCTION__;
+    std::size_t b = f.find("E = ")+4;
+    std::size_t e = f.find_first_of(";]", b);
+    return f.substr(b, e-b);
+#elif defined(_MSC_VER)
+    std::string_view f = __FUNCSIG__;
+    std::size_t b = f.find("error_type_name<")+16;
+    std::size_t e = f.rfind(">(");
+    return f.substr(b, e-b);
+#else
+    return "?";
+#endif
+}
+
+} // namespace detail
+
+template <typename E>
+const error_type_info& error_type_of() noexcept {
+    static const error_type_info info{detail::error_type_name<E>(), detail::error_type_count.fetch_add(1)};
+    return info;
+}
+
+// Set the telemetry hook, returning the previous hook; it is not
+// synchronized with hook calls and should be set before errors are produced.
+inline telemetry_hook set_telemetry_hook(telemetry_hook h) noexcept {
+    telemetry_hook prev = detail::telemetry_hook_fn;
+    detail::telemetry_hook_fn = h;
+    return prev;
+}
+
+namespace detail {
+
+template <typename E>
+constexpr void error_telemetry(error_event event) {
+#if defined(__cpp_lib_is_constant_evaluated)
+    if (std::is_constant_evaluated()) return;
+#elif defined(__GNUC__) || defined(__clang__)
+    if (__builtin_is_constant_evaluated()) return;
+#endif
+    if (telemetry_hook h = telemetry_hook_fn) h(event, error_type_of<E>());
+}
+
+} // namespace detail
+
+#endif // BACKPORT_EXPECTED_TELEMETRY
+
+
+// unexpect tag type: unexpect_t and unexpect are defined in expected_fwd.h
+
+
+// unexpected class
+
+template <typename E>
+struct unexpected {
+    template <typename F>
+    friend struct unexpected;
+
+    constexpr unexpected(const unexpected&) = default;
+    constexpr unexpected(unexpected&&) = default;
+
+    // emplacing constructors
+
+    template <typename F,
+        typename = std::enable_if_t<std::is_constructible_v<E, F>>,
+        typename = std::enable_if_t<!std::is_same_v<std::in_place_t, std::remove_cv_t<std::remove_reference_t<F>>>>,
+        typename = std::enable_if_t<!std::is_same_v<unexpected, std::remove_cv_t<std::remove_reference_t<F>>>>
+    >
+    constexpr explicit unexpected(F&& f):
+        error_(std::forward<F>(f)) { BACKPORT_EXPECTED_ERROR_EVENT(E, unexpected); }
+
+    template <typename... As>
+    constexpr explicit unexpected(std::in_place_t, As&&... as):
+        error_(std::forward<As>(as)...) { BACKPORT_EXPECTED_ERROR_EVENT(E, unexpected); }
+
+    template <typename X, typename... As>
+    constexpr explicit unexpected(std::in_place_t, std::initializer_list<X> il, As&&... as):
+        error_(il, std::forward<As>(as)...) { BACKPORT_EXPECTED_ERROR_EVENT(E, unexpected); }
+
+    // access
+
+    constexpr E& error() & { return error_; }
+    constexpr const E& error() const& { return error_; }
+    constexpr E&& error() && { return std::move(error_); }
+    constexpr const E&& error() const&& { return std::move(error_); }
+
+    // comparison
+
+    template <typename F>
+    friend constexpr bool operator==(const unexpected x, const backport::unexpected<F>& y) { return x.error()==y.error(); }
+
+    template <typename F>
+    friend constexpr bool operator!=(const unexpected x, const backport::unexpected<F>& y) { return x.error()!=y.error(); }
+
+    // swap
+
+    constexpr void swap(unexpected& other) noexcept(std::is_nothrow_swappable_v<E>) {
+        using std::swap;
+        swap(error_, other.error_);
+    }
+
+    friend constexpr void swap(unexpected& a, unexpected& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+
+private:
+    E error_;
+};
+
+template <typename E>
+unexpected(E) -> unexpected<E>;
+
+
+// niche_traits customization point
+//
+// A specialization with has_niche true declares that some object
+// representation of T is never taken by a valid value, and supplies:
+//
+//     static T niche() noexcept;
+//         Return an object with a niche representation.
+//     static bool is_niche(const T&) noexcept;
+//         Test whether an object has a niche representation.
+//     static constexpr std::size_t payload_offset, payload_size;
+//         Byte range within a niche representation that can be overwritten
+//         without the representation ceasing to be a niche.
+//
+// expected<T, E> uses a niche of T in place of a separate discriminator when
+// T and E are trivially copyable and E fits within the payload bytes.
+// expected<void, E> with trivially copyable E uses a niche of E to represent
+// success; an error equal to the niche is then indistinguishable from success.
+
+template <typename T, typename = void>
+struct niche_traits {
+    static constexpr bool has_niche = false;
+};
+
+// Declare a single value V of T as the niche, with no payload; suitable for
+// e.g. an out-of-range enum value.
+
+template <typename T, T V>
+struct niche_value_traits {
+    static constexpr bool has_niche = true;
+    static constexpr std::size_t payload_offset = 0;
+    static constexpr std::size_t payload_size = 0;
+
+    static constexpr T niche() noexcept { return V; }
+    static constexpr bool is_niche(const T& x) noexcept { return x==V; }
+};
+
+// std::errc has no zero-valued error.
+
+template <>
+struct niche_traits<std::errc>: niche_value_traits<std::errc, std::errc{}> {};
+
+// The niche of pointers to T when T has alignment greater than one: such
+// pointers never have their lowest address bit set. T need not be complete.
+
+template <typename T>
+struct aligned_pointer_niche_traits {
+    static constexpr bool has_niche = true;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+    static constexpr std::size_t payload_offset = 0;
+#else
+    static constexpr std::size_t payload_offset = 1;
+#endif
+    static constexpr std::size_t payload_size = sizeof(T*)-1;
+
+    static T* niche() noexcept { return reinterpret_cast<T*>(std::uintptr_t{1}); }
+    static bool is_niche(T* const& p) noexcept { return reinterpret_cast<std::uintptr_t>(p) & 1u; }
+};
+
+// Pointers to scalar types, which are always complete, use
+// aligned_pointer_niche_traits when the alignment is greater than one.
+//
+// The layout of expected<T*, E> must not depend on whether T happens to be
+// complete where it is instantiated, and T may be an opaque type that is
+// never defined, so for other T the niche is opt-in: niche_traits<T*> may be
+// specialized to derive from aligned_pointer_niche_traits<T> when alignof(T)
+// is greater than one.
+
+namespace detail {
+// alignof(T) for scalar T, otherwise 1, without requiring T to be complete
+template <typename T, bool = std::is_scalar_v<T>>
+inline constexpr std::size_t scalar_alignof_v = alignof(T);
+
+template <typename T>
+inline constexpr std::size_t scalar_alignof_v<T, false> = 1;
+}
+
+template <typename T>
+struct niche_traits<T*, std::enable_if_t<(detail::scalar_alignof_v<T>>1)>>:
+    aligned_pointer_niche_traits<T> {};
+
+namespace detail {
+template <typename T> struct ref_ptr;
+}
+
+// References held by expected<T&, E> share the niche of the corresponding pointer.
+
+template <typename T>
+struct niche_traits<detail::ref_ptr<T>, std::enable_if_t<niche_traits<T*>::has_niche>> {
+    static constexpr bool has_niche = true;
+    static constexpr std::size_t payload_offset = niche_traits<T*>::payload_offset;
+    static constexpr std::size_t payload_size = niche_traits<T*>::payload_size;
+
+    static detail::ref_ptr<T> niche() noexcept {
+        detail::ref_ptr<T> r;
+        r.ptr = niche_traits<T*>::niche();
+        return r;
+    }
+
+    static bool is_niche(const detail::ref_ptr<T>& r) noexcept { return niche_traits<T*>::is_niche(r.ptr); }
+};
+
+
+// boxed error storage
+//
+// expected<T, boxed<E>> holds an error of type E out of line, keeping only a
+// pointer inline. Its error_type is E, and it is constructed from and
+// compared with unexpected<E> just as expected<T, E> is.
+//
+// A boxed always holds an error. Move construction allocates a new E moved
+// from the source, which keeps its (moved-from) error, so that a moved-from
+// expected<T, boxed<E>> is usable as a moved-from expected<T, E> is; move
+// assignment exchanges the allocations. Only expected objects holding an
+// error hold a boxed, so moves of values are unaffected.
+
+template <typename E>
+struct boxed {
+    template <
+        typename... As,
+        std::enable_if_t<std::is_constructible_v<E, As...>, int> = 0,
+        std::enable_if_t<!(sizeof...(As)==1 && (std::is_same_v<boxed, std::remove_cv_t<std::remove_reference_t<As>>> && ...)), int> = 0
+    >
+    constexpr boxed(As&&... as): ptr_(new E(std::forward<As>(as)...)) {}
+
+    template <typename X, typename... As>
+    constexpr boxed(std::initializer_list<X> il, As&&... as): ptr_(new E(il, std::forward<As>(as)...)) {}
+
+    constexpr boxed(const boxed& other): ptr_(new E(*other.ptr_)) {}
+    constexpr boxed(boxed&& other): ptr_(new E(std::move(*other.ptr_))) {}
+
+    constexpr boxed& operator=(const boxed& other) {
+        *ptr_ = *other.ptr_;
+        return *this;
+    }
+
+    constexpr boxed& operator=(boxed&& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        return *this;
+    }
+
+    BACKPORT_CONSTEXPR20 ~boxed() { delete ptr_; }
+
+    constexpr E& operator*() const noexcept { return *ptr_; }
+
+    friend constexpr void swap(boxed& a, boxed& b) noexcept { std::swap(a.ptr_, b.ptr_); }
+
+private:
+    E* ptr_;
+};
+
+
+// expected class: the primary template is declared in expected_fwd.h, with
+// a third parameter that is true for void T.
+
+namespace detail {
+
+template <typename A, typename B>
+struct is_constructible_from_any_cref:
+    std::bool_constant<
+        std::is_constructible_v<A, B> ||
+        std::is_constructible_v<A, const B> ||
+        std::is_constructible_v<A, B&> ||
+        std::is_constructible_v<A, const B&>> {};
+
+template <typename A, typename B>
+struct is_convertible_from_any_cref:
+    std::bool_constant<
+        std::is_convertible_v<A, B> ||
+        std::is_convertible_v<const A, B> ||
+        std::is_convertible_v<A&, B> ||
+        std::is_convertible_v<const A&, B>
+    > {};
+
+template <typename A, typename B>
+inline constexpr bool is_constructible_from_any_cref_v = is_constructible_from_any_cref<A, B>::value;
+
+template <typename A, typename B>
+inline constexpr bool is_convertible_from_any_cref_v = is_convertible_from_any_cref<A, B>::value;
+
+template <typename A>
+struct is_unexpected: std::false_type {};
+
+template <typename A>
+struct is_unexpected<unexpected<A>>: std::true_type {};
+
+template <typename A>
+inline constexpr bool is_unexpected_v = is_unexpected<A>::value;
+
+template <typename A>
+struct is_expected: std::false_type {};
+
+template <typename A, typename B>
+struct is_expected<expected<A, B>>: std::true_type {};
+
+template <typename A>
+inline constexpr bool is_expected_v = is_expected<A>::value;
+
+// error_type of expected<T, E>: E with any boxed<> removed
+
+template <typename E>
+struct unboxed { using type = E; };
+
+template <typename E>
+struct unboxed<boxed<E>> { using type = E; };
+
+template <typename E>
+using unboxed_t = typename unboxed<E>::type;
+
+// Values of reference type are held as a ref_ptr.
+
+template <typename T>
+struct ref_ptr {
+    ref_ptr() = default;
+    constexpr ref_ptr(T& r) noexcept: ptr(std::addressof(r)) {}
+
+    T* ptr;
+};
+
+template <typename T>
+using stored_value_t = std::conditional_t<std::is_lvalue_reference_v<T>, ref_ptr<std::remove_reference_t<T>>, T>;
+
+// A reference value type may bind only to an lvalue, never to a temporary.
+
+template <typename T, typename... As>
+struct is_value_constructible: std::is_constructible<T, As...> {};
+
+template <typename T, typename A>
+struct is_value_constructible<T&, A>:
+    std::bool_constant<std::is_lvalue_reference_v<A> && std::is_convertible_v<std::remove_reference_t<A>*, T*>> {};
+
+template <typename T, typename... As>
+inline constexpr bool is_value_constructible_v = is_value_constructible<T, As...>::value;
+
+#if BACKPORT_EXPECTED_CONCEPTS
+// Constraints for the C++20 constructors; conjunctions and disjunctions in
+// a concept are evaluated only as far as needed.
+
+template <typename A, typename B>
+concept constructible_from_any_cref =
+    std::is_constructible_v<A, B> ||
+    std::is_constructible_v<A, const B> ||
+    std::is_constructible_v<A, B&> ||
+    std::is_constructible_v<A, const B&>;
+
+template <typename A, typename B>
+concept convertible_from_any_cref =
+    std::is_convertible_v<A, B> ||
+    std::is_convertible_v<const A, B> ||
+    std::is_convertible_v<A&, B> ||
+    std::is_convertible_v<const A&, B>;
+
+// expected<T, E> constructible from expected<U, F> with value and error
+// arguments of types Uq and Fq
+template <typename T, typename E, typename U, typename F, typename Uq, typename Fq>
+concept expected_constructible_from_other =
+    is_value_constructible_v<T, Uq> &&
+    std::is_constructible_v<E, Fq> &&
+    (std::is_same_v<bool, std::remove_cv_t<T>> ||
+        (!constructible_from_any_cref<T, expected<U, F>> &&
+         !convertible_from_any_cref<expected<U, F>, T> &&
+         !constructible_from_any_cref<unexpected<unboxed_t<E>>, expected<U, F>>));
+
+template <typename E, typename U, typename F, typename Fq>
+concept expected_void_constructible_from_other =
+    std::is_void_v<U> &&
+    std::is_constructible_v<E, Fq> &&
+    !constructible_from_any_cref<unexpected<unboxed_t<E>>, expected<U, F>>;
+
+// expected<T, E> constructible from a value of type U
+template <typename T, typename E, typename U>
+concept expected_constructible_from_value =
+    !std::is_same_v<std::in_place_t, std::remove_cv_t<std::remove_reference_t<U>>> &&
+    !std::is_same_v<expected<T, E>, std::remove_cv_t<std::remove_reference_t<U>>> &&
+    !is_unexpected_v<std::remove_cv_t<std::remove_reference_t<U>>> &&
+    !(std::is_same_v<bool, std::remove_cv_t<std::remove_reference_t<T>>> && is_expected_v<std::remove_cv_t<std::remove_reference_t<U>>>) &&
+    is_value_constructible_v<T, U>;
+#endif
+
+// The value type of the result of transform: lvalue references are kept,
+// anything else is decayed.
+
+template <typename R>
+using transform_result_t = std::conditional_t<std::is_lvalue_reference_v<R>, R, std::remove_cv_t<std::remove_reference_t<R>>>;
+
+// Access the value or error as held in storage: unwrap any boxed<> or ref_ptr<>.
+
+template <typename E>
+constexpr E& unbox(E& x) noexcept { return x; }
+
+template <typename E>
+constexpr const E& unbox(const E& x) noexcept { return x; }
+
+template <typename E>
+constexpr E& unbox(boxed<E>& x) noexcept { return *x; }
+
+template <typename E>
+constexpr const E& unbox(const boxed<E>& x) noexcept { return *x; }
+
+template <typename T>
+constexpr T& unbox(ref_ptr<T>& x) noexcept { return *x.ptr; }
+
+template <typename T>
+constexpr T& unbox(const ref_ptr<T>& x) noexcept { return *x.ptr; }
+
+// std::construct_at and std::invoke are constexpr only from C++20; invoke
+// is constexpr here in C++17 for anything other than a member pointer.
+
+template <typename T, typename... As>
+constexpr T* construct_at(T* p, As&&... as) {
+#if __cplusplus >= 202002L
+    return std::construct_at(p, std::forward<As>(as)...);
+#else
+    return ::new (static_cast<void*>(p)) T(std::forward<As>(as)...);
+#endif
+}
+
+template <typename F, typename... As>
+constexpr decltype(auto) invoke(F&& f, As&&... as) noexcept(std::is_nothrow_invocable_v<F, As...>) {
+    if constexpr (std::is_member_pointer_v<std::decay_t<F>>) return std::invoke(std::forward<F>(f), std::forward<As>(as)...);
+    else return std::forward<F>(f)(std::forward<As>(as)...);
+}
+
+// Construct the value or error of an expected from the result of invoking a
+// callable: a prvalue result initializes the stored object directly, without
+// an intermediate move, and need not be movable.
+
+struct in_place_invoke_t { explicit in_place_invoke_t() = default; };
+inline constexpr in_place_invoke_t in_place_invoke{};
+
+struct unexpect_invoke_t { explicit unexpect_invoke_t() = default; };
+inline constexpr unexpect_invoke_t unexpect_invoke{};
+
+// Evaluation of a pipeline (backport/pipeline.h), which constructs its
+// result in place as transform does.
+template <typename Result, typename Steps, std::size_t I>
+struct pipe_eval;
+
+// Evaluation of try_invoke (backport/try_invoke.h), likewise.
+struct try_invoke_eval;
+
+// Converts to the result of calling g, for initializing objects that can
+// only be constructed through an in_place constructor, such as the contents
+// of a std::optional.
+template <typename G>
+struct invoke_converter {
+    G g;
+    constexpr operator std::invoke_result_t<G&>() { return g(); }
+};
+
+template <typename G>
+invoke_converter(G) -> invoke_converter<G>;
+
+// Monadic operations, shared by both expected specializations and all
+// qualifications of the object: Self is a reference to the (possibly const)
+// expected, and is forwarded to obtain the value or error with the matching
+// value category.
+
+template <typename Self>
+using expected_self_t = std::remove_cv_t<std::remove_reference_t<Self>>;
+
+template <typename Self>
+inline constexpr bool has_void_value_v = std::is_void_v<typename expected_self_t<Self>::value_type>;
+
+template <typename Self, typename F>
+constexpr auto expected_and_then(Self&& self, F&& f) {
+    if constexpr (has_void_value_v<Self>) {
+        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F>>>;
+        return self? detail::invoke(std::forward<F>(f)): R(unexpect, std::forward<Self>(self).error());
+    }
+    else {
+        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, decltype(*std::declval<Self>())>>>;
+        return self? detail::invoke(std::forward<F>(f), *std::forward<Self>(self)): R(unexpect, std::forward<Self>(self).error());
+    }
+}
+
+template <typename Self, typename F>
+constexpr auto expected_or_else(Self&& self, F&& f) {
+    using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, decltype(std::declval<Self>().error())>>>;
+    if constexpr (has_void_value_v<Self>)
+        return self? R(): detail::invoke(std::forward<F>(f), std::forward<Self>(self).error());
+    else
+        return self? R(std::in_place, *std::forward<Self>(self)): detail::invoke(std::forward<F>(f), std::forward<Self>(self).error());
+}
+
+template <typename Self, typename F>
+constexpr auto expected_transform(Self&& self, F&& f) {
+    if constexpr (has_void_value_v<Self>) {
+        using U = transform_result_t<std::invoke_result_t<F>>;
+        using R = typename expected_self_t<Self>::template rebind<U>;
+        if constexpr (std::is_void_v<U>)
+            return self? detail::invoke(std::forward<F>(f)), R(): R(unexpect, std::forward<Self>(self).error());
+        else
+            return self? R(in_place_invoke, std::forward<F>(f)): R(unexpect, std::forward<Self>(self).error());
+    }
+    else {
+        using U = transform_result_t<std::invoke_result_t<F, decltype(*std::declval<Self>())>>;
+        using R = typename expected_self_t<Self>::template rebind<U>;
+        if constexpr (std::is_void_v<U>)
+            return self? detail::invoke(std::forward<F>(f), *std::forward<Self>(self)), R(): R(unexpect, std::forward<Self>(self).error());
+        else
+            return self? R(in_place_invoke, std::forward<F>(f), *std::forward<Self>(self)): R(unexpect, std::forward<Self>(self).error());
+    }
+}
+
+template <typename Self, typename F>
+constexpr auto expected_transform_error(Self&& self, F&& f) {
+    using X = expected_self_t<Self>;
+    using R = expected<typename X::value_type, std::remove_cv_t<std::invoke_result_t<F, decltype(std::declval<Self>().error())>>>;
+    if constexpr (has_void_value_v<Self>)
+        return self? R(): (BACKPORT_EXPECTED_ERROR_EVENT(typename X::error_type, transform_error), R(unexpect_invoke, std::forward<F>(f), std::forward<Self>(self).error()));
+    else
+        return self? R(std::in_place, *std::forward<Self>(self)): (BACKPORT_EXPECTED_ERROR_EVENT(typename X::error_type, transform_error), R(unexpect_invoke, std::forward<F>(f), std::forward<Self>(self).error()));
+}
+
+// In-place transformation: f is applied to the value or error where it is
+// held, and a non-void result is assigned back to it.
+
+template <typename V, typename F>
+constexpr void invoke_in_place(V& v, F&& f) {
+    if constexpr (std::is_void_v<std::invoke_result_t<F, V&>>) detail::invoke(std::forward<F>(f), v);
+    else v = detail::invoke(std::forward<F>(f), v);
+}
+
+template <typename X, typename F>
+constexpr void expected_transform_in_place(X& x, F&& f) {
+    if (x) invoke_in_place(*x, std::forward<F>(f));
+}
+
+template <typename X, typename F>
+constexpr void expected_transform_error_in_place(X& x, F&& f) {
+    if (!x) {
+        BACKPORT_EXPECTED_ERROR_EVENT(typename X::error_type, transform_error);
+        invoke_in_place(x.error(), std::forward<F>(f));
+    }
+}
+
+// Storage for expected<T, E> with non-void T: a union of T and E with a flag
+// recording which is live.
+//
+// Copy, move and destruction are layered so that each is trivial whenever
+// the corresponding operations on T and E are trivial; special members that
+// T or E do not support are deleted by virtue of the union's being deleted.
+
+struct from_other_t { explicit from_other_t() = default; };
+inline constexpr from_other_t from_other{};
+
+// An expected can be constructed from a class derived from result_binder,
+// which is then given the new object through bind(); coroutine promises use
+// this to fill in the result object in place (expected_coro.h).
+struct result_binder {};
+
+// An incomplete type, such as the referent of expected<Opaque&, E>, is not
+// a result binder.
+template <typename B, typename = void>
+struct is_result_binder: std::false_type {};
+
+template <typename B>
+struct is_result_binder<B, std::void_t<decltype(sizeof(B))>>: std::is_base_of<result_binder, B> {};
+
+template <typename B>
+inline constexpr bool is_result_binder_v = is_result_binder<std::remove_cv_t<std::remove_reference_t<B>>>::value;
+
+struct bind_result_t { explicit bind_result_t() = default; };
+inline constexpr bind_result_t bind_result{};
+
+// forward x with the value category and constness of S
+template <typename S, typename X>
+constexpr decltype(auto) forward_like(X& x) noexcept {
+    using Q = std::conditional_t<std::is_const_v<std::remove_reference_t<S>>, const X, X>;
+    if constexpr (std::is_lvalue_reference_v<S>) return static_cast<Q&>(x);
+    else return static_cast<Q&&>(x);
+}
+
+template <typename T, typename E>
+inline constexpr bool both_trivially_destructible_v =
+    std::is_trivially_destructible_v<T> && std::is_trivially_destructible_v<E>;
+
+template <typename T, typename E, bool = both_trivially_destructible_v<T, E>>
+struct expected_union {
+    template <typename... As>
+    constexpr explicit expected_union(std::in_place_t, As&&... as):
+        val_(std::forward<As>(as)...), has_val_(true) {}
+
+    template <typename... As>
+    constexpr explicit expected_union(unexpect_t, As&&... as):
+        err_(std::forward<As>(as)...), has_val_(false) {}
+
+    template <typename F, typename... As>
+    constexpr expected_union(in_place_invoke_t, F&& f, As&&... as):
+        val_(detail::invoke(std::forward<F>(f), std::forward<As>(as)...)), has_val_(true) {}
+
+    template <typename F, typename... As>
+    constexpr expected_union(unexpect_invoke_t, F&& f, As&&... as):
+        err_(detail::invoke(std::forward<F>(f), std::forward<As>(as)...)), has_val_(false) {}
+
+    // construct from the value or error of another expected storage
+    template <typename S>
+    constexpr expected_union(from_other_t, S&& other): has_val_(other.has_value()) {
+        if (has_val_) detail::construct_at(std::addressof(val_), forward_like<S>(other.val()));
+        else detail::construct_at(std::addressof(err_), forward_like<S>(other.stored_err()));
+    }
+
+    union {
+        T val_;
+        E err_;
+    };
+    bool has_val_;
+};
+
+template <typename T, typename E>
+struct expected_union<T, E, false> {
+    template <typename... As>
+    constexpr explicit expected_union(std::in_place_t, As&&... as):
+        val_(std::forward<As>(as)...), has_val_(true) {}
+
+    template <typename... As>
+    constexpr explicit expected_union(unexpect_t, As&&... as):
+        err_(std::forward<As>(as)...), has_val_(false) {}
+
+    template <typename F, typename... As>
+    constexpr expected_union(in_place_invoke_t, F&& f, As&&... as):
+        val_(detail::invoke(std::forward<F>(f), std::forward<As>(as)...)), has_val_(true) {}
+
+    template <typename F, typename... As>
+    constexpr expected_union(unexpect_invoke_t, F&& f, As&&... as):
+        err_(detail::invoke(std::forward<F>(f), std::forward<As>(as)...)), has_val_(false) {}
+
+    template <typename S>
+    constexpr expected_union(from_other_t, S&& other): has_val_(other.has_value()) {
+        if (has_val_) detail::construct_at(std::addressof(val_), forward_like<S>(other.val()));
+        else detail::construct_at(std::addressof(err_), forward_like<S>(other.stored_err()));
+    }
+
+    expected_union(const expected_union&) = default;
+    expected_union(expected_union&&) = default;
+    expected_union& operator=(const expected_union&) = default;
+    expected_union& operator=(expected_union&&) = default;
+
+    BACKPORT_CONSTEXPR20 ~expected_union() {
+        if (has_val_) val_.~T();
+        else err_.~E();
+    }
+
+    union {
+        T val_;
+        E err_;
+    };
+    bool has_val_;
+};
+
+template <typename T, typename E>
+struct expected_storage_ops: expected_union<T, E> {
+    using expected_union<T, E>::expected_union;
+
+    constexpr bool has_value() const noexcept { return this->has_val_; }
+
+    constexpr decltype(auto) val() noexcept { return unbox(this->val_); }
+    constexpr decltype(auto) val() const noexcept { return unbox(this->val_); }
+
+    constexpr T& stored_val() noexcept { return this->val_; }
+
+    constexpr unboxed_t<E>& err() noexcept { return unbox(this->err_); }
+    constexpr const unboxed_t<E>& err() const noexcept { return unbox(this->err_); }
+
+    // the error as held, in particular, still boxed
+    constexpr E& stored_err() noexcept { return this->err_; }
+    constexpr const E& stored_err() const noexcept { return this->err_; }
+
+    template <typename... As>
+    constexpr void construct_val(As&&... as) {
+        detail::construct_at(std::addressof(this->val_), std::forward<As>(as)...);
+        this->has_val_ = true;
+    }
+
+    template <typename... As>
+    constexpr void construct_err(As&&... as) {
+        detail::construct_at(std::addressof(this->err_), std::forward<As>(as)...);
+        this->has_val_ = false;
+    }
+
+    constexpr void destroy() noexcept {
+        if constexpr (!both_trivially_destructible_v<T, E>) {
+            if (this->has_val_) this->val_.~T();
+            else this->err_.~E();
+        }
+    }
+
+    // Switch between holding an error and holding a value, with the strong
+    // guarantee (the standard's reinit-expected). A construction that cannot
+    // throw is made in place; otherwise the new member is constructed first
+    // in a temporary and moved into place, or the old member is moved aside
+    // and restored if the construction throws, whichever move cannot throw.
+    // As for std::expected, the assignments that switch state are not
+    // available if both moves can throw (expected_reinit_v).
+
+    template <typename... As>
+    constexpr void reinit_val(As&&... as) {
+        if constexpr (std::is_nothrow_constructible_v<T, As...>) {
+            destroy();
+            construct_val(std::forward<As>(as)...);
+        }
+        else if constexpr (std::is_nothrow_move_constructible_v<T>) {
+            T tmp(std::forward<As>(as)...);
+            destroy();
+            construct_val(std::move(tmp));
+        }
+        else {
+            static_assert(std::is_nothrow_move_constructible_v<E>,
+                "expected: assigning a value to an error requires a value or error type that is nothrow move constructible");
+            reinit_val_guarded(std::forward<As>(as)...);
+        }
+    }
+
+    template <typename... As>
+    constexpr void reinit_err(As&&... as) {
+        if constexpr (std::is_nothrow_constructible_v<E, As...>) {
+            destroy();
+            construct_err(std::forward<As>(as)...);
+        }
+        else if constexpr (std::is_nothrow_move_constructible_v<E>) {
+            E tmp(std::forward<As>(as)...);
+            destroy();
+            construct_err(std::move(tmp));
+        }
+        else {
+            static_assert(std::is_nothrow_move_constructible_v<T>,
+                "expected: assigning an error to a value requires a value or error type that is nothrow move constructible");
+            reinit_err_guarded(std::forward<As>(as)...);
+        }
+    }
+
+    template <typename S>
+    constexpr void assign(S&& other) {
+        if (this->has_val_ && other.has_val_) this->val_ = forward_like<S>(other.val_);
+        else if (!this->has_val_ && !other.has_val_) this->err_ = forward_like<S>(other.err_);
+        else if (other.has_val_) reinit_val(forward_like<S>(other.val_));
+        else reinit_err(forward_like<S>(other.err_));
+    }
+
+    BACKPORT_CONSTEXPR20 void swap(expected_storage_ops& other) {
+        using std::swap;
+        if (this->has_val_ && other.has_val_) swap(this->val_, other.val_);
+        else if (!this->has_val_ && !other.has_val_) swap(this->err_, other.err_);
+        else if (this->has_val_) swap_mixed(*this, other);
+        else swap_mixed(other, *this);
+    }
+
+private:
+    template <typename... As>
+    BACKPORT_CONSTEXPR20 void reinit_val_guarded(As&&... as) {
+        E tmp(std::move(this->err_));
+        this->err_.~E();
+        BACKPORT_EXPECTED_TRY {
+            construct_val(std::forward<As>(as)...);
+        }
+        BACKPORT_EXPECTED_CATCH_ALL {
+            construct_err(std::move(tmp));
+            BACKPORT_EXPECTED_RETHROW;
+        }
+    }
+
+    template <typename... As>
+    BACKPORT_CONSTEXPR20 void reinit_err_guarded(As&&... as) {
+        T tmp(std::move(this->val_));
+        this->val_.~T();
+        BACKPORT_EXPECTED_TRY {
+            construct_err(std::forward<As>(as)...);
+        }
+        BACKPORT_EXPECTED_CATCH_ALL {
+            construct_val(std::move(tmp));
+            BACKPORT_EXPECTED_RETHROW;
+        }
+    }
+
+    static BACKPORT_CONSTEXPR20 void swap_mixed(expected_storage_ops& v, expected_storage_ops& u) {
+        if constexpr (std::is_nothrow_move_constructible_v<E>) {
+            E tmp(std::move(u.err_));
+            u.err_.~E();
+            BACKPORT_EXPECTED_TRY {
+                u.construct_val(std::move(v.val_));
+            }
+            BACKPORT_EXPECTED_CATCH_ALL {
+                u.construct_err(std::move(tmp));
+                BACKPORT_EXPECTED_RETHROW;
+            }
+            v.val_.~T();
+            v.construct_err(std::move(tmp));
+        }
+        else {
+            T tmp(std::move(v.val_));
+            v.val_.~T();
+            BACKPORT_EXPECTED_TRY {
+                v.construct_err(std::move(u.err_));
+            }
+            BACKPORT_EXPECTED_CATCH_ALL {
+                v.construct_val(std::move(tmp));
+                BACKPORT_EXPECTED_RETHROW;
+            }
+            u.err_.~E();
+            u.construct_val(std::move(tmp));
+        }
+    }
+};
+
+template <typename T, typename E>
+inline constexpr bool expected_trivial_copy_v =
+    std::is_trivially_copy_constructible_v<T> && std::is_trivially_copy_constructible_v<E>;
+
+template <typename T, typename E>
+inline constexpr bool expected_trivial_move_v =
+    std::is_trivially_move_constructible_v<T> && std::is_trivially_move_constructible_v<E>;
+
+template <typename T, typename E>
+inline constexpr bool expected_trivial_copy_assign_v =
+    expected_trivial_copy_v<T, E> && both_trivially_destructible_v<T, E> &&
+    std::is_trivially_copy_assignable_v<T> && std::is_trivially_copy_assignable_v<E>;
+
+template <typename T, typename E>
+inline constexpr bool expected_trivial_move_assign_v =
+    expected_trivial_move_v<T, E> && both_trivially_destructible_v<T, E> &&
+    std::is_trivially_move_assignable_v<T> && std::is_trivially_move_assignable_v<E>;
+
+// Whether a switch between value and error can be made with the strong
+// guarantee whatever the construction; otherwise, as for std::expected, the
+// copy and move assignments are deleted.
+template <typename T, typename E>
+inline constexpr bool expected_reinit_v =
+    std::is_nothrow_move_constructible_v<T> || std::is_nothrow_move_constructible_v<E>;
+
+template <typename T, typename E, bool =
+    expected_trivial_copy_v<T, E> ||
+    !(std::is_copy_constructible_v<T> && std::is_copy_constructible_v<E>)>
+struct expected_copy_layer: expected_storage_ops<T, E> {
+    using expected_storage_ops<T, E>::expected_storage_ops;
+};
+
+template <typename T, typename E>
+struct expected_copy_layer<T, E, false>: expected_storage_ops<T, E> {
+    using expected_storage_ops<T, E>::expected_storage_ops;
+
+    constexpr expected_copy_layer(const expected_copy_layer& other):
+        expected_storage_ops<T, E>(from_other, other) {}
+
+    expected_copy_layer(expected_copy_layer&&) = default;
+    expected_copy_layer& operator=(const expected_copy_layer&) = default;
+    expected_copy_layer& operator=(expected_copy_layer&&) = default;
+};
+
+template <typename T, typename E, bool =
+    expected_trivial_move_v<T, E> ||
+    !(std::is_move_constructible_v<T> && std::is_move_constructible_v<E>)>
+struct expected_move_layer: expected_copy_layer<T, E> {
+    using expected_copy_layer<T, E>::expected_copy_layer;
+};
+
+template <typename T, typename E>
+struct expected_move_layer<T, E, false>: expected_copy_layer<T, E> {
+    using expected_copy_layer<T, E>::expected_copy_layer;
+
+    expected_move_layer(const expected_move_layer&) = default;
+
+    constexpr expected_move_layer(expected_move_layer&& other)
+        noexcept(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_constructible_v<E>):
+        expected_copy_layer<T, E>(from_other, std::move(other)) {}
+
+    expected_move_layer& operator=(const expected_move_layer&) = default;
+    expected_move_layer& operator=(expected_move_layer&&) = default;
+};
+
+template <typename T, typename E, bool =
+    expected_trivial_copy_assign_v<T, E> ||
+    !(std::is_copy_constructible_v<T> && std::is_copy_constructible_v<E> &&
+      std::is_copy_assignable_v<T> && std::is_copy_assignable_v<E>),
+    bool = expected_reinit_v<T, E>>
+struct expected_copy_assign_layer: expected_move_layer<T, E> {
+    using expected_move_layer<T, E>::expected_move_layer;
+};
+
+template <typename T, typename E>
+struct expected_copy_assign_layer<T, E, false, false>: expected_move_layer<T, E> {
+    using expected_move_layer<T, E>::expected_move_layer;
+
+    expected_copy_assign_layer(const expected_copy_assign_layer&) = default;
+    expected_copy_assign_layer(expected_copy_assign_layer&&) = default;
+    expected_copy_assign_layer& operator=(const expected_copy_assign_layer&) = delete;
+    expected_copy_assign_layer& operator=(expected_copy_assign_layer&&) = default;
+};
+
+template <typename T, typename E>
+struct expected_copy_assign_layer<T, E, false, true>: expected_move_layer<T, E> {
+    using expected_move_layer<T, E>::expected_move_layer;
+
+    expected_copy_assign_layer(const expected_copy_assign_layer&) = default;
+    expected_copy_assign_layer(expected_copy_assign_layer&&) = default;
+
+    constexpr expected_copy_assign_layer& operator=(const expected_copy_assign_layer& other) {
+        this->assign(other);
+        return *this;
+    }
+
+    expected_copy_assign_layer& operator=(expected_copy_assign_layer&&) = default;
+};
+
+template <typename T, typename E, bool =
+    expected_trivial_move_assign_v<T, E> ||
+    !(std::is_move_constructible_v<T> && std::is_move_constructible_v<E> &&
+      std::is_move_assignable_v<T> && std::is_move_assignable_v<E>),
+    bool = expected_reinit_v<T, E>>
+struct expected_storage: expected_copy_assign_layer<T, E> {
+    using expected_copy_assign_layer<T, E>::expected_copy_assign_layer;
+};
+
+template <typename T, typename E>
+struct expected_storage<T, E, false, false>: expected_copy_assign_layer<T, E> {
+    using expected_copy_assign_layer<T, E>::expected_copy_assign_layer;
+
+    expected_storage(const expected_storage&) = default;
+    expected_storage(expected_storage&&) = default;
+    expected_storage& operator=(const expected_storage&) = default;
+    expected_storage& operator=(expected_storage&&) = delete;
+};
+
+template <typename T, typename E>
+struct expected_storage<T, E, false, true>: expected_copy_assign_layer<T, E> {
+    using expected_copy_assign_layer<T, E>::expected_copy_assign_layer;
+
+    expected_storage(const expected_storage&) = default;
+    expected_storage(expected_storage&&) = default;
+    expected_storage& operator=(const expected_storage&) = default;
+
+    constexpr expected_storage& operator=(expected_storage&& other)
+        noexcept(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_constructible_v<E> &&
+                 std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_assignable_v<E>)
+    {
+        this->assign(std::move(other));
+        return *this;
+    }
+};
+
+// Storage for expected<T, E> that records an error by writing a niche
+// representation of T, with the error itself constructed within the niche
+// payload bytes.
+
+template <typename T, typename E>
+inline constexpr std::size_t niche_error_offset =
+    (niche_traits<T>::payload_offset+alignof(E)-1)/alignof(E)*alignof(E);
+
+template <typename T, typename E, typename = void>
+struct use_niche_storage: std::false_type {};
+
+template <typename T, typename E>
+struct use_niche_storage<T, E, std::enable_if_t<niche_traits<T>::has_niche>>:
+    std::bool_constant<
+        std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<E> &&
+        std::is_trivially_destructible_v<T> && std::is_trivially_destructible_v<E> &&
+        std::is_trivially_default_constructible_v<T> &&
+        alignof(E)<=alignof(T) &&
+        niche_error_offset<T, E>+sizeof(E) <= niche_traits<T>::payload_offset+niche_traits<T>::payload_size
+    > {};
+
+template <typename T, typename E>
+struct expected_niche_storage {
+    using traits = niche_traits<T>;
+    static constexpr std::size_t err_offset = niche_error_offset<T, E>;
+
+    template <typename... As>
+    constexpr explicit expected_niche_storage(std::in_place_t, As&&... as):
+        val_(std::forward<As>(as)...) {}
+
+    template <typename... As>
+    explicit expected_niche_storage(unexpect_t, As&&... as): raw_{} {
+        set_niche();
+        ::new (static_cast<void*>(raw_+err_offset)) E(std::forward<As>(as)...);
+    }
+
+    template <typename F, typename... As>
+    constexpr expected_niche_storage(in_place_invoke_t, F&& f, As&&... as):
+        val_(detail::invoke(std::forward<F>(f), std::forward<As>(as)...)) {}
+
+    template <typename F, typename... As>
+    expected_niche_storage(unexpect_invoke_t, F&& f, As&&... as): raw_{} {
+        set_niche();
+        ::new (static_cast<void*>(raw_+err_offset)) E(detail::invoke(std::forward<F>(f), std::forward<As>(as)...));
+    }
+
+    template <typename S>
+    expected_niche_storage(from_other_t, S&& other): raw_{} {
+        if (other.has_value()) construct_val(forward_like<S>(other.val()));
+        else construct_err(forward_like<S>(other.stored_err()));
+    }
+
+    bool has_value() const noexcept {
+        T probe;
+        std::memcpy(&probe, raw_, sizeof(T));
+        return !traits::is_niche(probe);
+    }
+
+    constexpr decltype(auto) val() noexcept { return unbox(val_); }
+    constexpr decltype(auto) val() const noexcept { return unbox(val_); }
+
+    constexpr T& stored_val() noexcept { return val_; }
+
+    E& err() noexcept { return *std::launder(reinterpret_cast<E*>(raw_+err_offset)); }
+    const E& err() const noexcept { return *std::launder(reinterpret_cast<const E*>(raw_+err_offset)); }
+
+    E& stored_err() noexcept { return err(); }
+    const E& stored_err() const noexcept { return err(); }
+
+    template <typename... As>
+    void construct_val(As&&... as) {
+        ::new (static_cast<void*>(std::addressof(val_))) T(std::forward<As>(as)...);
+    }
+
+    template <typename... As>
+    void construct_err(As&&... as) {
+        E err(std::forward<As>(as)...);
+        set_niche();
+        ::new (static_cast<void*>(raw_+err_offset)) E(err);
+    }
+
+    void destroy() noexcept {}
+
+    // T is trivially copyable, so a value that may throw on construction
+    // is constructed aside first, and the error is left intact if it does.
+    template <typename... As>
+    void reinit_val(As&&... as) {
+        if constexpr (std::is_nothrow_constructible_v<T, As...>) construct_val(std::forward<As>(as)...);
+        else construct_val(T(std::forward<As>(as)...));
+    }
+
+    template <typename... As>
+    void reinit_err(As&&... as) { construct_err(std::forward<As>(as)...); }
+
+private:
+    void set_niche() noexcept {
+        T n = traits::niche();
+        std::memcpy(raw_, &n, sizeof(T));
+    }
+
+    union {
+        T val_;
+        alignas(T) unsigned char raw_[sizeof(T)];
+    };
+};
+
+// Storage for expected<T, E> when T and E are trivially copyable and
+// trivially destructible: the union and flag are direct members of a class
+// without bases, whose copy, move and destruction are all implicit. Held
+// directly in expected, it is then kept in registers and returned in them
+// where the ABI permits; the layered storage above places the union in a
+// base class subobject, whose tail padding may be reused, and GCC does not
+// scalarize such objects.
+
+template <typename T, typename E>
+inline constexpr bool use_flat_storage_v =
+    std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<E> &&
+    both_trivially_destructible_v<T, E>;
+
+template <typename T, typename E>
+struct expected_flat_storage {
+    template <typename... As>
+    constexpr explicit expected_flat_storage(std::in_place_t, As&&... as):
+        val_(std::forward<As>(as)...), has_val_(true) {}
+
+    template <typename... As>
+    constexpr explicit expected_flat_storage(unexpect_t, As&&... as):
+        err_(std::forward<As>(as)...), has_val_(false) {}
+
+    template <typename S>
+    constexpr expected_flat_storage(from_other_t, S&& other): has_val_(other.has_value()) {
+        if (has_val_) detail::construct_at(std::addressof(val_), forward_like<S>(other.val()));
+        else detail::construct_at(std::addressof(err_), forward_like<S>(other.stored_err()));
+    }
+
+    template <typename F, typename... As>
+    constexpr expected_flat_storage(in_place_invoke_t, F&& f, As&&... as):
+        val_(detail::invoke(std::forward<F>(f), std::forward<As>(as)...)), has_val_(true) {}
+
+    template <typename F, typename... As>
+    constexpr expected_flat_storage(unexpect_invoke_t, F&& f, As&&... as):
+        err_(detail::invoke(std::forward<F>(f), std::forward<As>(as)...)), has_val_(false) {}
 
-// unexpect tag type
+    constexpr bool has_value() const noexcept { return has_val_; }
 
-struct unexpect_t { explicit unexpect_t() = default; };
-inline constexpr unexpect_t unexpect{};
+    constexpr decltype(auto) val() noexcept { return unbox(val_); }
+    constexpr decltype(auto) val() const noexcept { return unbox(val_); }
 
+    constexpr T& stored_val() noexcept { return val_; }
 
-// unexpected class
+    constexpr E& err() noexcept { return err_; }
+    constexpr const E& err() const noexcept { return err_; }
 
-template <typename E>
-struct unexpected {
-    template <typename F>
-    friend struct unexpected;
+    constexpr E& stored_err() noexcept { return err_; }
+    constexpr const E& stored_err() const noexcept { return err_; }
 
-    constexpr unexpected(const unexpected&) = default;
-    constexpr unexpected(unexpected&&) = default;
+    template <typename... As>
+    constexpr void construct_val(As&&... as) {
+        detail::construct_at(std::addressof(val_), std::forward<As>(as)...);
+        has_val_ = true;
+    }
 
-    // emplacing constructors
+    template <typename... As>
+    constexpr void construct_err(As&&... as) {
+        detail::construct_at(std::addressof(err_), std::forward<As>(as)...);
+        has_val_ = false;
+    }
 
-    template <typename F,
-        typename = std::enable_if_t<std::is_constructible_v<E, F>>,
-        typename = std::enable_if_t<!std::is_same_v<std::in_place_t, std::remove_cv_t<std::remove_reference_t<F>>>>,
-        typename = std::enable_if_t<!std::is_same_v<unexpected, std::remove_cv_t<std::remove_reference_t<F>>>>
-    >
-    constexpr explicit unexpected(F&& f):
-        error_(std::forward<F>(f)) {}
+    constexpr void destroy() noexcept {}
+
+    // A construction that may throw is made aside first, so that the old
+    // member is left intact if it does.
 
     template <typename... As>
-    constexpr explicit unexpected(std::in_place_t, As&&... as):
-        error_(std::forward<As>(as)...) {}
+    constexpr void reinit_val(As&&... as) {
+        if constexpr (std::is_nothrow_constructible_v<T, As...>) construct_val(std::forward<As>(as)...);
+        else construct_val(T(std::forward<As>(as)...));
+    }
 
-    template <typename X, typename... As>
-    constexpr explicit unexpected(std::in_place_t, std::initializer_list<X> il, As&&... as):
-        error_(il, std::forward<As>(as)...) {}
+    template <typename... As>
+    constexpr void reinit_err(As&&... as) {
+        if constexpr (std::is_nothrow_constructible_v<E, As...>) construct_err(std::forward<As>(as)...);
+        else construct_err(E(std::forward<As>(as)...));
+    }
 
-    // access
+    union {
+        T val_;
+        E err_;
+    };
+    bool has_val_;
+};
 
-    constexpr E& error() & { return error_; }
-    constexpr const E& error() const& { return error_; }
-    constexpr E&& error() && { return std::move(error_); }
-    constexpr const E&& error() const&& { return std::move(error_); }
+template <typename T, typename E>
+using expected_storage_t = std::conditional_t<
+    use_niche_storage<T, E>::value,
+    expected_niche_storage<T, E>,
+    std::conditional_t<
+        use_flat_storage_v<T, E>,
+        expected_flat_storage<T, E>,
+        expected_storage<T, E>>>;
 
-    // comparison
+// Storage for expected<void, E>: an optional E.
 
-    template <typename F>
-    friend constexpr bool operator==(const unexpected x, const backport::unexpected<F>& y) { return x.error()==y.error(); }
+template <typename E>
+struct expected_void_storage {
+    constexpr expected_void_storage() noexcept = default;
 
-    template <typename F>
-    friend constexpr bool operator!=(const unexpected x, const backport::unexpected<F>& y) { return x.error()!=y.error(); }
+    template <typename... As>
+    constexpr explicit expected_void_storage(unexpect_t, As&&... as):
+        err_(std::in_place, std::forward<As>(as)...) {}
+
+    // A movable error is moved into place rather than converted, as the
+    // conversion could be captured by a constructor template of E.
+    template <typename F, typename... As>
+    constexpr expected_void_storage(unexpect_invoke_t, F&& f, As&&... as):
+        err_(std::in_place, make_err(std::forward<F>(f), std::forward<As>(as)...)) {}
+
+    template <typename S>
+    constexpr expected_void_storage(from_other_t, S&& other) {
+        if (!other.has_value()) err_.emplace(forward_like<S>(other.stored_err()));
+    }
 
-    // swap
+    constexpr bool has_value() const noexcept { return !err_.has_value(); }
 
-    constexpr void swap(unexpected& other) noexcept(std::is_nothrow_swappable_v<E>) {
+    constexpr unboxed_t<E>& err() noexcept { return unbox(*err_); }
+    constexpr const unboxed_t<E>& err() const noexcept { return unbox(*err_); }
+
+    constexpr E& stored_err() noexcept { return *err_; }
+    constexpr const E& stored_err() const noexcept { return *err_; }
+
+    constexpr void reset() noexcept { err_.reset(); }
+
+    template <typename G>
+    constexpr void assign_err(G&& g) {
+        if (err_) err() = std::forward<G>(g);
+        else err_.emplace(std::forward<G>(g));
+    }
+
+    constexpr void swap(expected_void_storage& other) {
         using std::swap;
-        swap(error_, other.error_);
+        swap(err_, other.err_);
     }
 
-    friend constexpr void swap(unexpected& a, unexpected& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    std::optional<E> err_;
 
 private:
-    E error_;
+    template <typename F, typename... As>
+    static constexpr decltype(auto) make_err(F&& f, As&&... as) {
+        if constexpr (std::is_move_constructible_v<E>)
+            return detail::invoke(std::forward<F>(f), std::forward<As>(as)...);
+        else
+            return invoke_converter{[&]() -> decltype(auto) { return detail::invoke(std::forward<F>(f), std::forward<As>(as)...); }};
+    }
 };
 
-template <typename E>
-unexpected(E) -> unexpected<E>;
+// Packed storage for expected<void, E> when E has a niche: the niche value
+// itself represents success, and no flag is required.
 
+template <typename E>
+struct expected_void_packed_storage {
+    using traits = niche_traits<E>;
 
-// expected class
-
-template <typename T, typename E, bool = std::is_void_v<T>>
-struct expected;
+    constexpr expected_void_packed_storage() noexcept: err_(traits::niche()) {}
 
-namespace detail {
+    template <typename... As>
+    constexpr explicit expected_void_packed_storage(unexpect_t, As&&... as):
+        err_(std::forward<As>(as)...) {}
 
-template <typename A, typename B>
-struct is_constructible_from_any_cref:
-    std::bool_constant<
-        std::is_constructible_v<A, B> ||
-        std::is_constructible_v<A, const B> ||
-        std::is_constructible_v<A, B&> ||
-        std::is_constructible_v<A, const B&>> {};
+    template <typename F, typename... As>
+    constexpr expected_void_packed_storage(unexpect_invoke_t, F&& f, As&&... as):
+        err_(detail::invoke(std::forward<F>(f), std::forward<As>(as)...)) {}
 
-template <typename A, typename B>
-struct is_convertible_from_any_cref:
-    std::bool_constant<
-        std::is_convertible_v<A, B> ||
-        std::is_convertible_v<const A, B> ||
-        std::is_convertible_v<A&, B> ||
-        std::is_convertible_v<const A&, B>
-    > {};
+    template <typename S>
+    constexpr expected_void_packed_storage(from_other_t, S&& other):
+        err_(other.has_value()? traits::niche(): E(forward_like<S>(other.stored_err()))) {}
 
-template <typename A, typename B>
-inline constexpr bool is_constructible_from_any_cref_v = is_constructible_from_any_cref<A, B>::value;
+    constexpr bool has_value() const noexcept { return traits::is_niche(err_); }
 
-template <typename A, typename B>
-inline constexpr bool is_convertible_from_any_cref_v = is_convertible_from_any_cref<A, B>::value;
+    constexpr E& err() noexcept { return err_; }
+    constexpr const E& err() const noexcept { return err_; }
 
-template <typename A>
-struct is_unexpected: std::false_type {};
+    constexpr E& stored_err() noexcept { return err_; }
+    constexpr const E& stored_err() const noexcept { return err_; }
 
-template <typename A>
-struct is_unexpected<unexpected<A>>: std::true_type {};
+    constexpr void reset() noexcept { err_ = traits::niche(); }
 
-template <typename A>
-inline constexpr bool is_unexpected_v = is_unexpected<A>::value;
+    template <typename G>
+    constexpr void assign_err(G&& g) { err_ = std::forward<G>(g); }
 
-template <typename A>
-struct is_expected: std::false_type {};
+    constexpr void swap(expected_void_packed_storage& other) noexcept { std::swap(err_, other.err_); }
 
-template <typename A, typename B>
-struct is_expected<expected<A, B>>: std::true_type {};
+    E err_;
+};
 
-template <typename A>
-inline constexpr bool is_expected_v = is_expected<A>::value;
+template <typename E>
+using expected_void_storage_t = std::conditional_t<
+    niche_traits<E>::has_niche && std::is_trivially_copyable_v<E>,
+    expected_void_packed_storage<E>,
+    expected_void_storage<E>>;
 
 } // namespace detail
 
@@ -169,21 +1488,63 @@ inline constexpr bool is_expected_v = is_expected<A>::value;
 
 template <typename T, typename E>
 struct expected<T, E, false> {
+    static_assert(!std::is_rvalue_reference_v<T>, "value type may not be an rvalue reference");
+
     using value_type = T;
-    using error_type = E;
-    using unexpected_type = unexpected<E>;
+    using error_type = detail::unboxed_t<E>;
+    using unexpected_type = unexpected<error_type>;
 
     template <typename U>
-    using rebind = expected<U, error_type>;
+    using rebind = expected<U, E>;
 
     template <typename, typename, bool>
     friend struct expected;
 
-    constexpr expected() noexcept(std::is_nothrow_default_constructible_v<data_type>) = default;
+    template <typename Self, typename F>
+    friend constexpr auto detail::expected_transform(Self&&, F&&);
+
+    template <typename Self, typename F>
+    friend constexpr auto detail::expected_transform_error(Self&&, F&&);
+
+    template <typename, typename, std::size_t>
+    friend struct detail::pipe_eval;
+
+    friend struct detail::try_invoke_eval;
+
+    template <typename U = T, std::enable_if_t<std::is_default_constructible_v<U>, int> = 0>
+    constexpr expected() noexcept(std::is_nothrow_default_constructible_v<T>):
+        data_(std::in_place) {}
 
     constexpr expected(const expected&) = default;
     constexpr expected(expected&&) noexcept(std::is_nothrow_move_constructible_v<data_type>) = default;
 
+#if BACKPORT_EXPECTED_CONCEPTS
+    // copy construction from a different expected type
+    template <typename U, typename F>
+        requires detail::expected_constructible_from_other<T, E, U, F, std::add_lvalue_reference_t<const U>, const F&>
+    constexpr explicit(!std::is_convertible_v<std::add_lvalue_reference_t<const U>, T> || !std::is_convertible_v<const F&, E>)
+    expected(const expected<U, F>& other):
+        data_(detail::from_other, other.data_) {}
+
+    // move construction from a different expected type
+    template <typename U, typename F>
+        requires detail::expected_constructible_from_other<T, E, U, F, U, F>
+    constexpr explicit(!std::is_convertible_v<U, T> || !std::is_convertible_v<F, E>)
+    expected(expected<U, F>&& other):
+        data_(detail::from_other, std::move(other.data_)) {}
+
+    // a reference value may not bind to the value of an expected rvalue
+    template <typename U, typename F>
+        requires (std::is_reference_v<T> && !std::is_reference_v<U>)
+    expected(expected<U, F>&& other) = delete;
+
+    // construction from compatible value type
+    template <typename U>
+        requires detail::expected_constructible_from_value<T, E, U>
+    constexpr explicit(!std::is_convertible_v<U, T>) expected(U&& value):
+        data_(std::in_place, std::forward<U>(value)) {}
+
+#else
     // implicit copy construction from a different expected type
     template <
         typename U,
@@ -191,12 +1552,12 @@ struct expected<T, E, false> {
         typename Ucref = std::add_lvalue_reference_t<const U>,
         typename Fcref = const F&,
         std::enable_if_t<
-            std::is_constructible_v<T, Ucref> &&
+            detail::is_value_constructible_v<T, Ucref> &&
             std::is_constructible_v<E, Fcref> &&
             (std::is_same_v<bool, std::remove_cv_t<T>> ||
                 (!detail::is_constructible_from_any_cref_v<T, expected<U, F>> &&
                 !detail::is_convertible_from_any_cref_v<expected<U, F>, T> &&
-                !detail::is_constructible_from_any_cref_v<unexpected<E>, expected<U, F>>)),
+                !detail::is_constructible_from_any_cref_v<unexpected_type, expected<U, F>>)),
             int
         > = 0,
         std::enable_if_t<
@@ -205,7 +1566,7 @@ struct expected<T, E, false> {
         > = 0
     >
     constexpr expected(const expected<U, F>& other):
-        data_(detail::convert_variant<decltype(data_)>(other.data_)) {}
+        data_(detail::from_other, other.data_) {}
 
     // explicit copy construction from a different expected type
     template <
@@ -214,12 +1575,12 @@ struct expected<T, E, false> {
         typename Ucref = std::add_lvalue_reference_t<const U>,
         typename Fcref = const F&,
         std::enable_if_t<
-            std::is_constructible_v<T, Ucref> &&
+            detail::is_value_constructible_v<T, Ucref> &&
             std::is_constructible_v<E, Fcref> &&
             (std::is_same_v<bool, std::remove_cv_t<T>> ||
                 (!detail::is_constructible_from_any_cref_v<T, expected<U, F>> &&
                 !detail::is_convertible_from_any_cref_v<expected<U, F>, T> &&
-                !detail::is_constructible_from_any_cref_v<unexpected<E>, expected<U, F>>)),
+                !detail::is_constructible_from_any_cref_v<unexpected_type, expected<U, F>>)),
             int
         > = 0,
         std::enable_if_t<
@@ -228,19 +1589,19 @@ struct expected<T, E, false> {
         > = true
     >
     constexpr explicit expected(const expected<U, F>& other):
-        data_(detail::convert_variant<decltype(data_)>(other.data_)) {}
+        data_(detail::from_other, other.data_) {}
 
     // implicit move construction from a different expected type
     template <
         typename U,
         typename F,
         std::enable_if_t<
-            std::is_constructible_v<T, U> &&
+            detail::is_value_constructible_v<T, U> &&
             std::is_constructible_v<E, F> &&
             (std::is_same_v<bool, std::remove_cv_t<T>> ||
                 (!detail::is_constructible_from_any_cref_v<T, expected<U, F>> &&
                 !detail::is_convertible_from_any_cref_v<expected<U, F>, T> &&
-                !detail::is_constructible_from_any_cref_v<unexpected<E>, expected<U, F>>)),
+                !detail::is_constructible_from_any_cref_v<unexpected_type, expected<U, F>>)),
             int
         > = 0,
         std::enable_if_t<
@@ -249,19 +1610,19 @@ struct expected<T, E, false> {
         > = 0
     >
     constexpr expected(expected<U, F>&& other):
-        data_(detail::convert_variant<decltype(data_)>(std::move(other.data_))) {}
+        data_(detail::from_other, std::move(other.data_)) {}
 
     // explicit move construction from a different expected type
     template <
         typename U,
         typename F,
         std::enable_if_t<
-            std::is_constructible_v<T, U> &&
+            detail::is_value_constructible_v<T, U> &&
             std::is_constructible_v<E, F> &&
             (std::is_same_v<bool, std::remove_cv_t<T>> ||
                 (!detail::is_constructible_from_any_cref_v<T, expected<U, F>> &&
                 !detail::is_convertible_from_any_cref_v<expected<U, F>, T> &&
-                !detail::is_constructible_from_any_cref_v<unexpected<E>, expected<U, F>>)),
+                !detail::is_constructible_from_any_cref_v<unexpected_type, expected<U, F>>)),
             int
         > = 0,
         std::enable_if_t<
@@ -270,13 +1631,21 @@ struct expected<T, E, false> {
         > = 0
     >
     constexpr explicit expected(expected<U, F>&& other):
-        data_(detail::convert_variant<decltype(data_)>(std::move(other.data_))) {}
+        data_(detail::from_other, std::move(other.data_)) {}
+
+    // a reference value may not bind to the value of an expected rvalue
+    template <
+        typename U,
+        typename F,
+        std::enable_if_t<std::is_reference_v<T> && !std::is_reference_v<U>, int> = 0
+    >
+    expected(expected<U, F>&& other) = delete;
 
     // implicit construction from compatible value type
     template <
         typename U,
         std::enable_if_t<
-            std::is_constructible_v<T, U> &&
+            detail::is_value_constructible_v<T, U> &&
             !std::is_same_v<std::in_place_t, std::remove_cv_t<std::remove_reference_t<U>>> &&
             !std::is_same_v<expected, std::remove_cv_t<std::remove_reference_t<U>>> &&
             !detail::is_unexpected_v<std::remove_cv_t<std::remove_reference_t<U>>> &&
@@ -286,13 +1655,13 @@ struct expected<T, E, false> {
         std::enable_if_t<std::is_convertible_v<U, T>, int> = 0
     >
     constexpr expected(U&& value):
-        data_(std::in_place_index<0>, std::forward<U>(value)) {}
+        data_(std::in_place, std::forward<U>(value)) {}
 
     // explicit construction from compatible value type
     template <
         typename U,
         std::enable_if_t<
-            std::is_constructible_v<T, U> &&
+            detail::is_value_constructible_v<T, U> &&
             !std::is_same_v<std::in_place_t, std::remove_cv_t<std::remove_reference_t<U>>> &&
             !std::is_same_v<expected, std::remove_cv_t<std::remove_reference_t<U>>> &&
             !detail::is_unexpected_v<std::remove_cv_t<std::remove_reference_t<U>>> &&
@@ -302,34 +1671,48 @@ struct expected<T, E, false> {
         std::enable_if_t<!std::is_convertible_v<U, T>, int> = 0
     >
     constexpr explicit expected(U&& value):
-        data_(std::in_place_index<0>, std::forward<U>(value)) {}
+        data_(std::in_place, std::forward<U>(value)) {}
+#endif
+
+#if BACKPORT_EXPECTED_CONCEPTS
+    // construction from compatible unexpected type
+    template <typename F>
+        requires std::is_constructible_v<E, const F&>
+    constexpr explicit(!std::is_convertible_v<const F&, E>) expected(const unexpected<F>& unexp):
+        data_(unexpect, unexp.error()) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
+
+    template <typename F>
+        requires std::is_constructible_v<E, F>
+    constexpr explicit(!std::is_convertible_v<F, E>) expected(unexpected<F>&& unexp):
+        data_(unexpect, std::move(unexp.error())) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
+#else
     // implicit copy construction from compatible unexpected type
     template <
         typename F,
         std::enable_if_t<std::is_constructible_v<E, const F&>, int> = 0,
-        std::enable_if_t<std::is_convertible_v<F, E>, int> = 0
+        std::enable_if_t<std::is_convertible_v<const F&, E>, int> = 0
     >
     constexpr expected(const unexpected<F>& unexp):
-        data_(std::in_place_index<1>, unexp.error()) {}
+        data_(unexpect, unexp.error()) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
     // explicit copy construction from compatible unexpected type
     template <
         typename F,
         std::enable_if_t<std::is_constructible_v<E, const F&>, int> = 0,
-        std::enable_if_t<!std::is_convertible_v<F, E>, int> = 0
+        std::enable_if_t<!std::is_convertible_v<const F&, E>, int> = 0
     >
     constexpr explicit expected(const unexpected<F>& unexp):
-        data_(std::in_place_index<1>, unexp.error()) {}
+        data_(unexpect, unexp.error()) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
     // implicit move construction from compatible unexpected type
     template <
         typename F,
-        std::enable_if_t<std::is_constructible_v<E, const F&>, int> = 0,
-        std::enable_if_t<std::is_convertible_v<const F&, E>, int> = 0
+        std::enable_if_t<std::is_constructible_v<E, F>, int> = 0,
+        std::enable_if_t<std::is_convertible_v<F, E>, int> = 0
     >
     constexpr expected(unexpected<F>&& unexp):
-        data_(std::in_place_index<1>, std::move(unexp.error())) {}
+        data_(unexpect, std::move(unexp.error())) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
     // explicit move construction from compatible unexpected type
     template <
@@ -338,28 +1721,39 @@ struct expected<T, E, false> {
         std::enable_if_t<!std::is_convertible_v<F, E>, int> = 0
     >
     constexpr explicit expected(unexpected<F>&& unexp):
-        data_(std::in_place_index<1>, std::move(unexp.error())) {}
+        data_(unexpect, std::move(unexp.error())) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
+#endif
 
     // constructors using in_place_t, unexpect_t
     template <typename... As,
-              typename = std::enable_if_t<std::is_constructible_v<T, As...>>>
+              typename = std::enable_if_t<detail::is_value_constructible_v<T, As...>>>
     constexpr explicit expected(std::in_place_t, As&&... as):
-        data_(std::in_place_index<0>, std::forward<As>(as)...) {}
+        data_(std::in_place, std::forward<As>(as)...) {}
 
     template <typename X,
               typename... As,
               typename = std::enable_if_t<std::is_constructible_v<T, std::initializer_list<X>&, As...>>>
     constexpr explicit expected(std::in_place_t, std::initializer_list<X> il, As&&... as):
-        data_(std::in_place_index<0>, il, std::forward<As>(as)...) {}
+        data_(std::in_place, il, std::forward<As>(as)...) {}
 
     template <typename... As,
               typename = std::enable_if_t<std::is_constructible_v<E, As...>>>
     constexpr explicit expected(unexpect_t, As&&... as):
-        data_(std::in_place_index<1>, std::forward<As>(as)...) {}
+        data_(unexpect, std::forward<As>(as)...) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
     template <typename X, typename... As, typename = std::enable_if_t<std::is_constructible_v<E, std::initializer_list<X>&, As...>>>
     constexpr explicit expected(unexpect_t, std::initializer_list<X> il, As&&... as):
-        data_(std::in_place_index<1>, il, std::forward<As>(as)...) {}
+        data_(unexpect, il, std::forward<As>(as)...) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
+
+    // Construct with a value-initialized value, or if T is not default
+    // constructible, a value-initialized error, and call b.bind(*this).
+    template <
+        typename B,
+        std::enable_if_t<detail::is_result_binder_v<B> &&
+            (std::is_default_constructible_v<T> || std::is_default_constructible_v<E>), int> = 0
+    >
+    constexpr expected(B&& b):
+        expected(detail::bind_result, b, std::is_default_constructible<T>{}) {}
 
     // assignment
 
@@ -376,91 +1770,104 @@ struct expected<T, E, false> {
         typename U,
         std::enable_if_t<!std::is_same_v<expected, std::remove_cv_t<std::remove_reference_t<U>>>, int> = 0,
         std::enable_if_t<!detail::is_unexpected_v<std::remove_cv_t<std::remove_reference_t<U>>>, int> = 0,
-        std::enable_if_t<std::is_constructible_v<T, U>, int> = 0,
-        std::enable_if_t<std::is_assignable_v<T&, U>, int> = 0
+        std::enable_if_t<detail::is_value_constructible_v<T, U>, int> = 0,
+        std::enable_if_t<std::is_reference_v<T> || std::is_assignable_v<T&, U>, int> = 0,
+        std::enable_if_t<std::is_nothrow_constructible_v<T, U> || detail::expected_reinit_v<T, E>, int> = 0
     >
     constexpr expected& operator=(U&& other) {
-        if (has_value()) std::get<0>(data_) = std::forward<U>(other);
-        else data_.template emplace<0>(std::forward<U>(other));
+        // a reference value is rebound, not assigned through
+        if (!has_value()) data_.reinit_val(std::forward<U>(other));
+        else if constexpr (std::is_reference_v<T>) data_.stored_val() = std::forward<U>(other);
+        else data_.val() = std::forward<U>(other);
         return *this;
     }
 
     template <
         typename G,
         std::enable_if_t<std::is_constructible_v<E, const G&>, int> = 0,
-        std::enable_if_t<std::is_assignable_v<E&, const G&>, int> =0
+        std::enable_if_t<std::is_assignable_v<E&, const G&>, int> = 0,
+        std::enable_if_t<std::is_nothrow_constructible_v<E, const G&> || detail::expected_reinit_v<T, E>, int> = 0
     >
     constexpr expected& operator=(const unexpected<G>& unexp) {
-        if (!has_value()) std::get<1>(data_) = unexp.error();
-        else data_.template emplace<1>(unexp.error());
+        if (!has_value()) data_.err() = unexp.error();
+        else data_.reinit_err(unexp.error());
         return *this;
     }
 
     template <
         typename G,
         std::enable_if_t<std::is_constructible_v<E, G>, int> = 0,
-        std::enable_if_t<std::is_assignable_v<E&, G>, int> =0
+        std::enable_if_t<std::is_assignable_v<E&, G>, int> = 0,
+        std::enable_if_t<std::is_nothrow_constructible_v<E, G> || detail::expected_reinit_v<T, E>, int> = 0
     >
     constexpr expected& operator=(unexpected<G>&& unexp) {
-        if (!has_value()) std::get<1>(data_) = std::move(unexp).error();
-        else data_.template emplace<1>(std::move(unexp).error());
+        if (!has_value()) data_.err() = std::move(unexp).error();
+        else data_.reinit_err(std::move(unexp).error());
         return *this;
     }
 
     // access methods
 
-    explicit operator bool() const noexcept { return data_.index()==0; }
-    bool has_value() const noexcept { return data_.index()==0; }
+    constexpr explicit operator bool() const noexcept { return data_.has_value(); }
+    constexpr bool has_value() const noexcept { return data_.has_value(); }
+
+    constexpr error_type& error() & { BACKPORT_EXPECTED_PRE(!has_value()); return data_.err(); }
+    constexpr const error_type& error() const& { BACKPORT_EXPECTED_PRE(!has_value()); return data_.err(); }
+    constexpr error_type&& error() && { BACKPORT_EXPECTED_PRE(!has_value()); return std::move(data_.err()); }
+    constexpr const error_type&& error() const&& { BACKPORT_EXPECTED_PRE(!has_value()); return std::move(data_.err()); }
 
-    E& error() & { return std::get<1>(data_); }
-    const E& error() const& { return std::get<1>(data_); }
-    E&& error() && { return std::get<1>(std::move(data_)); }
-    const E&& error() const&& { return std::get<1>(std::move(data_)); }
+    // For reference T, T&& and const T& collapse to T: access is shallow.
 
-    T* operator->() noexcept { return std::get_if<0>(&data_); }
-    const T* operator->() const noexcept { return std::get_if<0>(&data_); }
+    constexpr std::add_pointer_t<T> operator->() noexcept { BACKPORT_EXPECTED_PRE(has_value()); return std::addressof(data_.val()); }
+    constexpr std::add_pointer_t<const T> operator->() const noexcept { BACKPORT_EXPECTED_PRE(has_value()); return std::addressof(data_.val()); }
 
-    T& operator*() & noexcept { return std::get<0>(data_); }
-    const T& operator*() const& noexcept { return std::get<0>(data_); }
-    T&& operator*() && noexcept { return std::get<0>(std::move(data_)); }
-    const T&& operator*() const&& noexcept { return std::get<0>(std::move(data_)); }
+    constexpr T& operator*() & noexcept { BACKPORT_EXPECTED_PRE(has_value()); return data_.val(); }
+    constexpr const T& operator*() const& noexcept { BACKPORT_EXPECTED_PRE(has_value()); return data_.val(); }
+    constexpr T&& operator*() && noexcept { BACKPORT_EXPECTED_PRE(has_value()); return static_cast<T&&>(data_.val()); }
+    constexpr const T&& operator*() const&& noexcept { BACKPORT_EXPECTED_PRE(has_value()); return static_cast<const T&&>(data_.val()); }
 
-    T& value() & {
-        return *this? std::get<0>(data_): throw bad_expected_access(std::as_const(error()));
+    constexpr T& value() & {
+        if (!*this) detail::throw_failure(bad_expected_access(std::as_const(error())));
+        return data_.val();
     }
 
-    const T& value() const& {
-        return *this? std::get<0>(data_): throw bad_expected_access(std::as_const(error()));
+    constexpr const T& value() const& {
+        if (!*this) detail::throw_failure(bad_expected_access(std::as_const(error())));
+        return data_.val();
     }
 
-    T&& value() && {
-        return *this? std::get<0>(std::move(data_)): throw bad_expected_access(std::move(error()));
+    constexpr T&& value() && {
+        if (!*this) detail::throw_failure(bad_expected_access(std::move(error())));
+        return static_cast<T&&>(data_.val());
     }
 
-    const T&& value() const&& {
-        return *this? std::get<0>(std::move(data_)): throw bad_expected_access(std::move(error()));
+    constexpr const T&& value() const&& {
+        if (!*this) detail::throw_failure(bad_expected_access(std::move(error())));
+        return static_cast<const T&&>(data_.val());
     }
 
+    // value_or returns a copy even for reference T, as the alternative may be a temporary.
+
     template <typename U>
-    constexpr T value_or(U&& alt) const& {
+    constexpr std::remove_cv_t<std::remove_reference_t<T>> value_or(U&& alt) const& {
         if (has_value()) return **this;
         return std::forward<U>(alt);
     }
 
     template <typename U>
-    constexpr T value_or(U&& alt) && {
-        if (has_value()) return std::move(**this);
+    constexpr std::remove_cv_t<std::remove_reference_t<T>> value_or(U&& alt) && {
+        if (has_value()) return *std::move(*this);
         return std::forward<U>(alt);
     }
 
     template <typename U>
-    constexpr E error_or(U&& alt) const& {
+    constexpr error_type error_or(U&& alt) const& {
         if (has_value()) return std::forward<U>(alt);
         return error();
     }
 
     template <typename U>
-    constexpr E error_or(U&& alt) && {
+    constexpr error_type error_or(U&& alt) && {
         if (has_value()) return std::forward<U>(alt);
         return std::move(error());
     }
@@ -469,7 +1876,8 @@ struct expected<T, E, false> {
 
     template <typename U, typename F, std::enable_if_t<!std::is_void_v<F>, int> = 0>
     friend constexpr bool operator==(const expected& x, const backport::expected<U, F>& y) {
-        return x.data_ == y.data_;
+        if (x.has_value()!=y.has_value()) return false;
+        return x.has_value()? *x == *y: x.error() == y.error();
     }
 
     template <typename U, std::enable_if_t<!detail::is_expected_v<U> && !detail::is_unexpected_v<U>, int> = 0>
@@ -501,113 +1909,67 @@ struct expected<T, E, false> {
 
     // monadic operations
 
-    template <typename F>
-    auto and_then(F&& f) & {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, T&>>>;
-        return *this? std::invoke(std::forward<F>(f), **this): R(unexpect, error());
-    }
+#if BACKPORT_EXPECTED_DEDUCING_THIS
+    template <typename Self, typename F>
+    constexpr auto and_then(this Self&& self, F&& f) { return detail::expected_and_then(std::forward<Self>(self), std::forward<F>(f)); }
 
-    template <typename F>
-    auto and_then(F&& f) const& {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, const T&>>>;
-        return *this? std::invoke(std::forward<F>(f), **this): R(unexpect, error());
-    }
+    template <typename Self, typename F>
+    constexpr auto or_else(this Self&& self, F&& f) { return detail::expected_or_else(std::forward<Self>(self), std::forward<F>(f)); }
 
-    template <typename F>
-    auto and_then(F&& f) && {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, T&&>>>;
-        return *this? std::invoke(std::forward<F>(f), std::move(**this)): R(unexpect, std::move(error()));
-    }
+    template <typename Self, typename F>
+    constexpr auto transform(this Self&& self, F&& f) { return detail::expected_transform(std::forward<Self>(self), std::forward<F>(f)); }
 
+    template <typename Self, typename F>
+    constexpr auto transform_error(this Self&& self, F&& f) { return detail::expected_transform_error(std::forward<Self>(self), std::forward<F>(f)); }
+#else
     template <typename F>
-    auto and_then(F&& f) const&& {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, const T&&>>>;
-        return *this? std::invoke(std::forward<F>(f), std::move(**this)): R(unexpect, std::move(error()));
-    }
-
+    constexpr auto and_then(F&& f) & { return detail::expected_and_then(*this, std::forward<F>(f)); }
     template <typename F>
-    auto or_else(F&& f) & {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, E&>>>;
-        return *this? R(std::in_place, **this): std::invoke(std::forward<F>(f), error());
-    }
-
+    constexpr auto and_then(F&& f) const& { return detail::expected_and_then(*this, std::forward<F>(f)); }
     template <typename F>
-    auto or_else(F&& f) const& {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, const E&>>>;
-        return *this? R(std::in_place, **this): std::invoke(std::forward<F>(f), error());
-    }
-
+    constexpr auto and_then(F&& f) && { return detail::expected_and_then(std::move(*this), std::forward<F>(f)); }
     template <typename F>
-    auto or_else(F&& f) && {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, E&&>>>;
-        return *this? R(std::in_place, std::move(**this)): std::invoke(std::forward<F>(f), std::move(error()));
-    }
+    constexpr auto and_then(F&& f) const&& { return detail::expected_and_then(std::move(*this), std::forward<F>(f)); }
 
     template <typename F>
-    auto or_else(F&& f) const&& {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, const E&&>>>;
-        return *this? R(std::in_place, std::move(**this)): std::invoke(std::forward<F>(f), std::move(error()));
-    }
-
+    constexpr auto or_else(F&& f) & { return detail::expected_or_else(*this, std::forward<F>(f)); }
     template <typename F>
-    auto transform(F&& f) & {
-        using U = std::remove_cv_t<std::invoke_result_t<F, T&>>;
-        if constexpr (std::is_void_v<U>)
-            return *this? std::invoke(std::forward<F>(f), **this), expected<U, E>(): expected<U, E>(unexpect, error());
-        else
-            return *this? expected<U, E>(std::in_place, std::invoke(std::forward<F>(f), **this)): expected<U, E>(unexpect, error());
-    }
-
+    constexpr auto or_else(F&& f) const& { return detail::expected_or_else(*this, std::forward<F>(f)); }
     template <typename F>
-    auto transform(F&& f) const& {
-        using U = std::remove_cv_t<std::invoke_result_t<F, const T&>>;
-        if constexpr (std::is_void_v<U>)
-            return *this? std::invoke(std::forward<F>(f), **this), expected<U, E>(): expected<U, E>(unexpect, error());
-        else
-            return *this? expected<U, E>(std::in_place, std::invoke(std::forward<F>(f), **this)): expected<U, E>(unexpect, error());
-    }
-
+    constexpr auto or_else(F&& f) && { return detail::expected_or_else(std::move(*this), std::forward<F>(f)); }
     template <typename F>
-    auto transform(F&& f) && {
-        using U = std::remove_cv_t<std::invoke_result_t<F, T&&>>;
-        if constexpr (std::is_void_v<U>)
-            return *this? std::invoke(std::forward<F>(f), std::move(**this)), expected<U, E>(): expected<U, E>(unexpect, std::move(error()));
-        else
-            return *this? expected<U, E>(std::in_place, std::invoke(std::forward<F>(f), std::move(**this))): expected<U, E>(unexpect, std::move(error()));
-    }
+    constexpr auto or_else(F&& f) const&& { return detail::expected_or_else(std::move(*this), std::forward<F>(f)); }
 
     template <typename F>
-    auto transform(F&& f) const&& {
-        using U = std::remove_cv_t<std::invoke_result_t<F, const T&&>>;
-        if constexpr (std::is_void_v<U>)
-            return *this? std::invoke(std::forward<F>(f), std::move(**this)), expected<U, E>(): expected<U, E>(unexpect, std::move(error()));
-        else
-            return *this? expected<U, E>(std::in_place, std::invoke(std::forward<F>(f), std::move(**this))): expected<U, E>(unexpect, std::move(error()));
-    }
-
+    constexpr auto transform(F&& f) & { return detail::expected_transform(*this, std::forward<F>(f)); }
     template <typename F>
-    auto transform_error(F&& f) & {
-        using R = expected<T, std::remove_cv_t<std::invoke_result_t<F, E&>>>;
-        return *this? R(std::in_place, **this): R(unexpect, std::invoke(std::forward<F>(f), error()));
-    }
+    constexpr auto transform(F&& f) const& { return detail::expected_transform(*this, std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform(F&& f) && { return detail::expected_transform(std::move(*this), std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform(F&& f) const&& { return detail::expected_transform(std::move(*this), std::forward<F>(f)); }
 
     template <typename F>
-    auto transform_error(F&& f) const& {
-        using R = expected<T, std::remove_cv_t<std::invoke_result_t<F, const E&>>>;
-        return *this? R(std::in_place, **this): R(unexpect, std::invoke(std::forward<F>(f), error()));
-    }
+    constexpr auto transform_error(F&& f) & { return detail::expected_transform_error(*this, std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform_error(F&& f) const& { return detail::expected_transform_error(*this, std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform_error(F&& f) && { return detail::expected_transform_error(std::move(*this), std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform_error(F&& f) const&& { return detail::expected_transform_error(std::move(*this), std::forward<F>(f)); }
+#endif
+
+    // in-place transformation of the value or error, returning *this
 
     template <typename F>
-    auto transform_error(F&& f) && {
-        using R = expected<T, std::remove_cv_t<std::invoke_result_t<F, E&&>>>;
-        return *this? R(std::in_place, std::move(**this)): R(unexpect, std::invoke(std::forward<F>(f), std::move(error())));
-    }
+    constexpr expected& transform_in_place(F&& f) & { detail::expected_transform_in_place(*this, std::forward<F>(f)); return *this; }
+    template <typename F>
+    constexpr expected&& transform_in_place(F&& f) && { detail::expected_transform_in_place(*this, std::forward<F>(f)); return std::move(*this); }
 
     template <typename F>
-    auto transform_error(F&& f) const&& {
-        using R = expected<T, std::remove_cv_t<std::invoke_result_t<F, const E&&>>>;
-        return *this? R(std::in_place, std::move(**this)): R(unexpect, std::invoke(std::forward<F>(f), std::move(error())));
-    }
+    constexpr expected& transform_error_in_place(F&& f) & { detail::expected_transform_error_in_place(*this, std::forward<F>(f)); return *this; }
+    template <typename F>
+    constexpr expected&& transform_error_in_place(F&& f) && { detail::expected_transform_error_in_place(*this, std::forward<F>(f)); return std::move(*this); }
 
     // emplace expected value
 
@@ -615,27 +1977,65 @@ struct expected<T, E, false> {
         typename... As,
         std::enable_if_t<std::is_nothrow_constructible_v<T, As...>, int> = 0
     >
-    T& emplace(As&&... as) noexcept { return data_.template emplace<0>(std::forward<As>(as)...); }
+    constexpr T& emplace(As&&... as) noexcept {
+        data_.destroy();
+        data_.construct_val(std::forward<As>(as)...);
+        return data_.val();
+    }
 
     template <
         typename X,
         typename... As,
         std::enable_if_t<std::is_nothrow_constructible_v<T, std::initializer_list<X>&, As...>, int> = 0
     >
-    T& emplace(std::initializer_list<X> il, As&&... as) noexcept { return data_.template emplace<0>(il, std::forward<As>(as)...); }
+    constexpr T& emplace(std::initializer_list<X> il, As&&... as) noexcept {
+        data_.destroy();
+        data_.construct_val(il, std::forward<As>(as)...);
+        return data_.val();
+    }
 
     // swap
 
-    void swap(expected& other) noexcept(std::is_nothrow_swappable_v<data_type>) {
-        using std::swap;
-        swap(data_, other.data_);
+    // Trivially copyable contents are swapped bytewise.
+
+    BACKPORT_CONSTEXPR20 void swap(expected& other)
+        noexcept((std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<E>) ||
+                 (std::is_nothrow_move_constructible_v<T> && std::is_nothrow_swappable_v<T> &&
+                  std::is_nothrow_move_constructible_v<E> && std::is_nothrow_swappable_v<E>))
+    {
+        if constexpr (std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<E>) {
+            data_type tmp(data_);
+            data_ = other.data_;
+            other.data_ = tmp;
+        }
+        else {
+            data_.swap(other.data_);
+        }
     }
 
-    friend void swap(expected& a, expected& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    friend BACKPORT_CONSTEXPR20 void swap(expected& a, expected& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
 
 private:
-    using data_type = std::variant<T, E>;
+    using data_type = detail::expected_storage_t<detail::stored_value_t<T>, E>;
     data_type data_;
+
+    template <typename B>
+    constexpr expected(detail::bind_result_t, B& b, std::true_type):
+        data_(std::in_place) { b.bind(*this); }
+
+    template <typename B>
+    constexpr expected(detail::bind_result_t, B& b, std::false_type):
+        data_(unexpect) { b.bind(*this); }
+
+    // Construct the value or error from the result of f(as...), without
+    // moving it (transform, transform_error).
+    template <typename F, typename... As>
+    constexpr expected(detail::in_place_invoke_t, F&& f, As&&... as):
+        data_(detail::in_place_invoke, std::forward<F>(f), std::forward<As>(as)...) {}
+
+    template <typename F, typename... As>
+    constexpr expected(detail::unexpect_invoke_t, F&& f, As&&... as):
+        data_(detail::unexpect_invoke, std::forward<F>(f), std::forward<As>(as)...) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 };
 
 
@@ -644,19 +2044,42 @@ private:
 template <typename T, typename E>
 struct expected<T, E, true> {
     using value_type = T; // TS is possibly cv-qualified void
-    using error_type = E;
-    using unexpected_type = unexpected<E>;
+    using error_type = detail::unboxed_t<E>;
+    using unexpected_type = unexpected<error_type>;
 
     template <typename U>
-    using rebind = expected<U, error_type>;
+    using rebind = expected<U, E>;
 
     template <typename, typename, bool>
     friend struct expected;
 
+    template <typename Self, typename F>
+    friend constexpr auto detail::expected_transform(Self&&, F&&);
+
+    template <typename Self, typename F>
+    friend constexpr auto detail::expected_transform_error(Self&&, F&&);
+
+    template <typename, typename, std::size_t>
+    friend struct detail::pipe_eval;
+
     constexpr expected() noexcept(std::is_nothrow_default_constructible_v<data_type>) = default;
     constexpr expected(const expected&) = default;
     constexpr expected(expected&&) noexcept(std::is_nothrow_move_constructible_v<data_type>) = default;
 
+#if BACKPORT_EXPECTED_CONCEPTS
+    // copy construction from a different expected type
+    template <typename U, typename F>
+        requires detail::expected_void_constructible_from_other<E, U, F, const F&>
+    constexpr explicit(!std::is_convertible_v<const F&, E>) expected(const expected<U, F>& other):
+        data_(detail::from_other, other.data_) {}
+
+    // move construction from a different expected type
+    template <typename U, typename F>
+        requires detail::expected_void_constructible_from_other<E, U, F, F>
+    constexpr explicit(!std::is_convertible_v<F, E>) expected(expected<U, F>&& other):
+        data_(detail::from_other, std::move(other.data_)) {}
+
+#else
     // implicit copy construction from a different expected type
     template <
         typename U,
@@ -664,13 +2087,13 @@ struct expected<T, E, true> {
         std::enable_if_t<
             std::is_void_v<U> &&
             std::is_constructible_v<E, const F&> &&
-            !detail::is_constructible_from_any_cref_v<unexpected<E>, expected<U, F>>,
+            !detail::is_constructible_from_any_cref_v<unexpected_type, expected<U, F>>,
             int
         > = 0,
         std::enable_if_t<std::is_convertible_v<const F&, E>, int> = 0
     >
     constexpr expected(const expected<U, F>& other):
-        data_(other.data_) {}
+        data_(detail::from_other, other.data_) {}
 
     // explicit copy construction from a different expected type
     template <
@@ -679,13 +2102,13 @@ struct expected<T, E, true> {
         std::enable_if_t<
             std::is_void_v<U> &&
             std::is_constructible_v<E, const F&> &&
-            !detail::is_constructible_from_any_cref_v<unexpected<E>, expected<U, F>>,
+            !detail::is_constructible_from_any_cref_v<unexpected_type, expected<U, F>>,
             int
         > = 0,
         std::enable_if_t<!std::is_convertible_v<const F&, E>, int> = 0
     >
    constexpr explicit expected(const expected<U, F>& other):
-        data_(other.data_) {}
+        data_(detail::from_other, other.data_) {}
 
 
     // implicit move construction from a different expected type
@@ -695,13 +2118,13 @@ struct expected<T, E, true> {
         std::enable_if_t<
             std::is_void_v<U> &&
             std::is_constructible_v<E, F&&> &&
-            !detail::is_constructible_from_any_cref_v<unexpected<E>, expected<U, F>>,
+            !detail::is_constructible_from_any_cref_v<unexpected_type, expected<U, F>>,
             int
         > = 0,
         std::enable_if_t<std::is_convertible_v<F&&, E>, int> = 0
     >
     constexpr expected(expected<U, F>&& other):
-        data_(std::move(other.data_)) {}
+        data_(detail::from_other, std::move(other.data_)) {}
 
     // explicit move construction from a different expected type
     template <
@@ -710,14 +2133,28 @@ struct expected<T, E, true> {
         std::enable_if_t<
             std::is_void_v<U> &&
             std::is_constructible_v<E, F&&> &&
-            !detail::is_constructible_from_any_cref_v<unexpected<E>, expected<U, F>>,
+            !detail::is_constructible_from_any_cref_v<unexpected_type, expected<U, F>>,
             int
         > = 0,
         std::enable_if_t<!std::is_convertible_v<F&&, E>, int> = 0
     >
    constexpr explicit expected(expected<U, F>&& other):
-        data_(std::move(other.data_)) {}
+        data_(detail::from_other, std::move(other.data_)) {}
+#endif
+
+#if BACKPORT_EXPECTED_CONCEPTS
+    // construction from compatible unexpected type
+    template <typename F>
+        requires std::is_constructible_v<E, const F&>
+    constexpr explicit(!std::is_convertible_v<const F&, E>) expected(const unexpected<F>& unexp):
+        data_(unexpect, unexp.error()) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
+
+    template <typename F>
+        requires std::is_constructible_v<E, F>
+    constexpr explicit(!std::is_convertible_v<F, E>) expected(unexpected<F>&& unexp):
+        data_(unexpect, std::move(unexp.error())) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
+#else
     // implicit copy construction from compatible unexpected type
     template <
         typename F,
@@ -725,7 +2162,7 @@ struct expected<T, E, true> {
         std::enable_if_t<std::is_convertible_v<const F&, E>, int> = 0
     >
     constexpr expected(const unexpected<F>& unexp):
-        data_(std::in_place, unexp.error()) {}
+        data_(unexpect, unexp.error()) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
     // explicit copy construction from compatible unexpected type
     template <
@@ -734,7 +2171,7 @@ struct expected<T, E, true> {
         std::enable_if_t<!std::is_convertible_v<const F&, E>, int> = 0
     >
     constexpr explicit expected(const unexpected<F>& unexp):
-        data_(std::in_place, unexp.error()) {}
+        data_(unexpect, unexp.error()) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
     // implicit move construction from compatible unexpected type
     template <
@@ -743,7 +2180,7 @@ struct expected<T, E, true> {
         std::enable_if_t<std::is_convertible_v<F, E>, int> = 0
     >
     constexpr expected(unexpected<F>&& unexp):
-        data_(std::in_place, std::move(unexp.error())) {}
+        data_(unexpect, std::move(unexp.error())) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
     // explicit move construction from compatible unexpected type
     template <
@@ -752,7 +2189,8 @@ struct expected<T, E, true> {
         std::enable_if_t<!std::is_convertible_v<F, E>, int> = 0
     >
     constexpr explicit expected(unexpected<F>&& unexp):
-        data_(std::in_place, std::move(unexp.error())) {}
+        data_(unexpect, std::move(unexp.error())) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
+#endif
 
     // constructors using in_place_t, unexpect_t
     constexpr explicit expected(std::in_place_t) {}
@@ -760,11 +2198,15 @@ struct expected<T, E, true> {
     template <typename... As,
               typename = std::enable_if_t<std::is_constructible_v<E, As...>>>
     constexpr explicit expected(unexpect_t, As&&... as):
-        data_(std::in_place, std::forward<As>(as)...) {}
+        data_(unexpect, std::forward<As>(as)...) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 
     template <typename X, typename... As, typename = std::enable_if_t<std::is_constructible_v<E, std::initializer_list<X>&, As...>>>
     constexpr explicit expected(unexpect_t, std::initializer_list<X> il, As&&... as):
-        data_(std::in_place, il, std::forward<As>(as)...) {}
+        data_(unexpect, il, std::forward<As>(as)...) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
+
+    // Construct with a value and call b.bind(*this).
+    template <typename B, std::enable_if_t<detail::is_result_binder_v<B>, int> = 0>
+    constexpr expected(B&& b) { b.bind(*this); }
 
     // assignment
 
@@ -780,7 +2222,7 @@ struct expected<T, E, true> {
         std::enable_if_t<std::is_assignable_v<E&, const G&>, int> =0
     >
     constexpr expected& operator=(const unexpected<G>& unexp) {
-        data_ = unexp.error();
+        data_.assign_err(unexp.error());
         return *this;
     }
 
@@ -790,33 +2232,33 @@ struct expected<T, E, true> {
         std::enable_if_t<std::is_assignable_v<E&, G>, int> =0
     >
     constexpr expected& operator=(unexpected<G>&& unexp) {
-        data_ = std::move(unexp).error();
+        data_.assign_err(std::move(unexp).error());
         return *this;
     }
 
     // access methods
 
     constexpr explicit operator bool() const noexcept { return has_value(); }
-    constexpr bool has_value() const noexcept { return !data_.has_value(); }
+    constexpr bool has_value() const noexcept { return data_.has_value(); }
 
-    constexpr E& error() & { return *data_; }
-    constexpr const E& error() const& { return *data_; }
-    constexpr E&& error() && { return *std::move(data_); }
-    constexpr const E&& error() const&& { return *std::move(data_); }
+    constexpr error_type& error() & { BACKPORT_EXPECTED_PRE(!has_value()); return data_.err(); }
+    constexpr const error_type& error() const& { BACKPORT_EXPECTED_PRE(!has_value()); return data_.err(); }
+    constexpr error_type&& error() && { BACKPORT_EXPECTED_PRE(!has_value()); return std::move(data_.err()); }
+    constexpr const error_type&& error() const&& { BACKPORT_EXPECTED_PRE(!has_value()); return std::move(data_.err()); }
 
-    constexpr void value() const& { if (!has_value()) throw bad_expected_access(std::as_const(error())); }
-    constexpr void value() && { if (!has_value()) throw bad_expected_access(std::move(error())); }
+    constexpr void value() const& { if (!has_value()) detail::throw_failure(bad_expected_access(std::as_const(error()))); }
+    constexpr void value() && { if (!has_value()) detail::throw_failure(bad_expected_access(std::move(error()))); }
 
-    constexpr void operator*() const noexcept {}
+    constexpr void operator*() const noexcept { BACKPORT_EXPECTED_PRE(has_value()); }
 
     template <typename U>
-    constexpr E error_or(U&& alt) const& {
+    constexpr error_type error_or(U&& alt) const& {
         if (has_value()) return std::forward<U>(alt);
         return error();
     }
 
     template <typename U>
-    constexpr E error_or(U&& alt) && {
+    constexpr error_type error_or(U&& alt) && {
         if (has_value()) return std::forward<U>(alt);
         return std::move(error());
     }
@@ -825,7 +2267,8 @@ struct expected<T, E, true> {
 
     template <typename U, typename F, std::enable_if_t<std::is_void_v<U>, int> = 0>
     friend constexpr bool operator==(const expected& x, const backport::expected<U, F>& y) {
-        return x.data_ == y.data_;
+        if (x.has_value()!=y.has_value()) return false;
+        return x.has_value() || x.error() == y.error();
     }
 
     template <typename F>
@@ -847,113 +2290,62 @@ struct expected<T, E, true> {
 
     // monadic operations
 
-    template <typename F>
-    auto and_then(F&& f) & {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F>>>;
-        return *this? std::invoke(std::forward<F>(f)): R(unexpect, error());
-    }
+#if BACKPORT_EXPECTED_DEDUCING_THIS
+    template <typename Self, typename F>
+    constexpr auto and_then(this Self&& self, F&& f) { return detail::expected_and_then(std::forward<Self>(self), std::forward<F>(f)); }
 
-    template <typename F>
-    auto and_then(F&& f) const& {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F>>>;
-        return *this? std::invoke(std::forward<F>(f)): R(unexpect, error());
-    }
+    template <typename Self, typename F>
+    constexpr auto or_else(this Self&& self, F&& f) { return detail::expected_or_else(std::forward<Self>(self), std::forward<F>(f)); }
 
-    template <typename F>
-    auto and_then(F&& f) && {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F>>>;
-        return *this? std::invoke(std::forward<F>(f)): R(unexpect, std::move(error()));
-    }
+    template <typename Self, typename F>
+    constexpr auto transform(this Self&& self, F&& f) { return detail::expected_transform(std::forward<Self>(self), std::forward<F>(f)); }
 
+    template <typename Self, typename F>
+    constexpr auto transform_error(this Self&& self, F&& f) { return detail::expected_transform_error(std::forward<Self>(self), std::forward<F>(f)); }
+#else
     template <typename F>
-    auto and_then(F&& f) const&& {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F>>>;
-        return *this? std::invoke(std::forward<F>(f)): R(unexpect, std::move(error()));
-    }
-
+    constexpr auto and_then(F&& f) & { return detail::expected_and_then(*this, std::forward<F>(f)); }
     template <typename F>
-    auto or_else(F&& f) & {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, E&>>>;
-        return *this? R(): std::invoke(std::forward<F>(f), error());
-    }
-
+    constexpr auto and_then(F&& f) const& { return detail::expected_and_then(*this, std::forward<F>(f)); }
     template <typename F>
-    auto or_else(F&& f) const& {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, const E&>>>;
-        return *this? R(): std::invoke(std::forward<F>(f), error());
-    }
-
+    constexpr auto and_then(F&& f) && { return detail::expected_and_then(std::move(*this), std::forward<F>(f)); }
     template <typename F>
-    auto or_else(F&& f) && {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, E&&>>>;
-        return *this? R(): std::invoke(std::forward<F>(f), std::move(error()));
-    }
+    constexpr auto and_then(F&& f) const&& { return detail::expected_and_then(std::move(*this), std::forward<F>(f)); }
 
     template <typename F>
-    auto or_else(F&& f) const&& {
-        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, const E&&>>>;
-        return *this? R(): std::invoke(std::forward<F>(f), std::move(error()));
-    }
-
+    constexpr auto or_else(F&& f) & { return detail::expected_or_else(*this, std::forward<F>(f)); }
     template <typename F>
-    auto transform(F&& f) & {
-        using U = std::remove_cv_t<std::invoke_result_t<F>>;
-        if constexpr (std::is_void_v<U>)
-            return *this? std::invoke(std::forward<F>(f)), expected<U, E>(): expected<U, E>(unexpect, error());
-        else
-            return *this? expected<U, E>(std::in_place, std::invoke(std::forward<F>(f))): expected<U, E>(unexpect, error());
-    }
-
+    constexpr auto or_else(F&& f) const& { return detail::expected_or_else(*this, std::forward<F>(f)); }
     template <typename F>
-    auto transform(F&& f) const& {
-        using U = std::remove_cv_t<std::invoke_result_t<F>>;
-        if constexpr (std::is_void_v<U>)
-            return *this? std::invoke(std::forward<F>(f)), expected<U, E>(): expected<U, E>(unexpect, error());
-        else
-            return *this? expected<U, E>(std::in_place, std::invoke(std::forward<F>(f))): expected<U, E>(unexpect, error());
-    }
-
+    constexpr auto or_else(F&& f) && { return detail::expected_or_else(std::move(*this), std::forward<F>(f)); }
     template <typename F>
-    auto transform(F&& f) && {
-        using U = std::remove_cv_t<std::invoke_result_t<F>>;
-        if constexpr (std::is_void_v<U>)
-            return *this? std::invoke(std::forward<F>(f)), expected<U, E>(): expected<U, E>(unexpect, std::move(error()));
-        else
-            return *this? expected<U, E>(std::in_place, std::invoke(std::forward<F>(f))): expected<U, E>(unexpect, std::move(error()));
-    }
+    constexpr auto or_else(F&& f) const&& { return detail::expected_or_else(std::move(*this), std::forward<F>(f)); }
 
     template <typename F>
-    auto transform(F&& f) const&& {
-        using U = std::remove_cv_t<std::invoke_result_t<F>>;
-        if constexpr (std::is_void_v<U>)
-            return *this? std::invoke(std::forward<F>(f)), expected<U, E>(): expected<U, E>(unexpect, std::move(error()));
-        else
-            return *this? expected<U, E>(std::in_place, std::invoke(std::forward<F>(f))): expected<U, E>(unexpect, std::move(error()));
-    }
-
+    constexpr auto transform(F&& f) & { return detail::expected_transform(*this, std::forward<F>(f)); }
     template <typename F>
-    auto transform_error(F&& f) & {
-        using R = expected<T, std::remove_cv_t<std::invoke_result_t<F, E&>>>;
-        return *this? R(): R(unexpect, std::invoke(std::forward<F>(f), error()));
-    }
-
+    constexpr auto transform(F&& f) const& { return detail::expected_transform(*this, std::forward<F>(f)); }
     template <typename F>
-    auto transform_error(F&& f) const& {
-        using R = expected<T, std::remove_cv_t<std::invoke_result_t<F, const E&>>>;
-        return *this? R(): R(unexpect, std::invoke(std::forward<F>(f), error()));
-    }
+    constexpr auto transform(F&& f) && { return detail::expected_transform(std::move(*this), std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform(F&& f) const&& { return detail::expected_transform(std::move(*this), std::forward<F>(f)); }
 
     template <typename F>
-    auto transform_error(F&& f) && {
-        using R = expected<T, std::remove_cv_t<std::invoke_result_t<F, E&&>>>;
-        return *this? R(): R(unexpect, std::invoke(std::forward<F>(f), std::move(error())));
-    }
+    constexpr auto transform_error(F&& f) & { return detail::expected_transform_error(*this, std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform_error(F&& f) const& { return detail::expected_transform_error(*this, std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform_error(F&& f) && { return detail::expected_transform_error(std::move(*this), std::forward<F>(f)); }
+    template <typename F>
+    constexpr auto transform_error(F&& f) const&& { return detail::expected_transform_error(std::move(*this), std::forward<F>(f)); }
+#endif
+
+    // in-place transformation of the error, returning *this
 
     template <typename F>
-    auto transform_error(F&& f) const&& {
-        using R = expected<T, std::remove_cv_t<std::invoke_result_t<F, const E&&>>>;
-        return *this? R(): R(unexpect, std::invoke(std::forward<F>(f), std::move(error())));
-    }
+    constexpr expected& transform_error_in_place(F&& f) & { detail::expected_transform_error_in_place(*this, std::forward<F>(f)); return *this; }
+    template <typename F>
+    constexpr expected&& transform_error_in_place(F&& f) && { detail::expected_transform_error_in_place(*this, std::forward<F>(f)); return std::move(*this); }
 
     // emplace expected value
 
@@ -961,16 +2353,80 @@ struct expected<T, E, true> {
 
     // swap
 
-    void swap(expected& other) noexcept(std::is_nothrow_swappable_v<data_type>) {
-        using std::swap;
-        swap(data_, other.data_);
+    BACKPORT_CONSTEXPR20 void swap(expected& other)
+        noexcept(std::is_nothrow_move_constructible_v<E> && std::is_nothrow_swappable_v<E>)
+    {
+        data_.swap(other.data_);
     }
 
-    friend void swap(expected& a, expected& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    friend BACKPORT_CONSTEXPR20 void swap(expected& a, expected& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
 
 private:
-    using data_type = std::optional<error_type>;
+    using data_type = detail::expected_void_storage_t<E>;
     data_type data_;
+
+    // Construct the error from the result of f(as...), without moving it
+    // (transform_error).
+    template <typename F, typename... As>
+    constexpr expected(detail::unexpect_invoke_t, F&& f, As&&... as):
+        data_(detail::unexpect_invoke, std::forward<F>(f), std::forward<As>(as)...) { BACKPORT_EXPECTED_ERROR_EVENT(error_type, expected); }
 };
 
+
+// trivial relocation
+//
+// is_trivially_relocatable<T> declares that moving a T to a new address and
+// destroying the original is equivalent to copying its bytes. It may be
+// specialized for user types; expected and unexpected are relocatable when
+// their contents are.
+
+template <typename T, typename = void>
+struct is_trivially_relocatable:
+    std::bool_constant<std::is_trivially_move_constructible_v<T> && std::is_trivially_destructible_v<T>> {};
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+template <typename E>
+struct is_trivially_relocatable<boxed<E>>: std::true_type {};
+
+template <typename T>
+struct is_trivially_relocatable<detail::ref_ptr<T>>: std::true_type {};
+
+template <typename E>
+struct is_trivially_relocatable<unexpected<E>>: is_trivially_relocatable<E> {};
+
+template <typename T, typename E>
+struct is_trivially_relocatable<expected<T, E, false>>:
+    std::bool_constant<is_trivially_relocatable_v<detail::stored_value_t<T>> && is_trivially_relocatable_v<E>> {};
+
+template <typename T, typename E>
+struct is_trivially_relocatable<expected<T, E, true>>: is_trivially_relocatable<E> {};
+
+// Move n objects from first to the uninitialized, non-overlapping storage at
+// dest, ending their lifetimes at first; returns dest+n. Trivially
+// relocatable objects are copied bytewise. Otherwise, as with
+// std::move_if_noexcept, objects whose move constructor may throw are copied
+// if they are copyable, so that if construction throws, the source objects
+// are left intact; objects of a move-only type whose move constructor throws
+// are left in a valid but unspecified state.
+
+template <typename T>
+T* relocate_n(T* first, std::size_t n, T* dest) {
+    if constexpr (is_trivially_relocatable_v<T>) {
+        if (n) std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first), n*sizeof(T));
+        return dest+n;
+    }
+    else if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+        T* end = std::uninitialized_move_n(first, n, dest).second;
+        std::destroy_n(first, n);
+        return end;
+    }
+    else {
+        T* end = std::uninitialized_copy_n(first, n, dest);
+        std::destroy_n(first, n);
+        return end;
+    }
+}
+
 } // namespace backport
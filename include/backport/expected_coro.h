@@ -0,0 +1,204 @@
+#pragma once
+
+// Coroutine support for expected (C++20)
+//
+// A coroutine returning expected<T, E> runs to completion when called. Within
+// it, co_await x for an expected x gives the value of x, or if x holds an
+// error, ends the coroutine and returns that error as the result:
+//
+//     expected<int, std::string> sum(const std::string& a, const std::string& b) {
+//         int x = co_await parse(a);
+//         int y = co_await parse(b);
+//         co_return x+y;
+//     }
+//
+// co_return takes anything that can be assigned to expected<T, E>, including
+// an unexpected; a coroutine returning expected<void, E> uses co_return {} for
+// success. Only expected objects may be awaited. Exceptions propagate to the
+// caller.
+//
+// A coroutine whose first two parameters are std::allocator_arg_t and an
+// allocator has its frame allocated by (a rebound copy of) that allocator.
+//
+// The frame never outlives the call and its handle is never stored or passed
+// out of the promise, so that compilers which perform heap allocation elision
+// can place the frame in the caller's stack frame once the coroutine is
+// inlined.
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <backport/expected.h>
+
+namespace backport {
+
+namespace detail {
+
+template <typename R>
+class coro_return;
+
+// The result object is either the result of the coroutine call, bound to the
+// promise before the coroutine body runs, or if the compiler converts the
+// return object only after the body has run, storage in the return object.
+
+template <typename R>
+struct coro_promise {
+    R* slot_ = nullptr;
+    std::optional<R>* pending_ = nullptr;
+
+    coro_return<R> get_return_object() noexcept { return coro_return<R>(*this); }
+
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() {
+#if BACKPORT_EXPECTED_EXCEPTIONS
+        throw;
+#else
+        std::abort();
+#endif
+    }
+
+    template <typename U = std::conditional_t<std::is_void_v<typename R::value_type>, R, typename R::value_type>>
+    void return_value(U&& u) {
+        if (slot_) *slot_ = std::forward<U>(u);
+        else pending_->emplace(std::forward<U>(u));
+    }
+
+    template <typename G>
+    void return_error(G&& g) {
+        using error_type = typename R::error_type;
+        if (slot_) *slot_ = unexpected<error_type>(std::forward<G>(g));
+        else pending_->emplace(unexpect, std::forward<G>(g));
+    }
+
+    template <typename X>
+    auto await_transform(X&& x) noexcept;
+};
+
+template <typename R>
+class coro_return: public result_binder {
+public:
+    explicit coro_return(coro_promise<R>& p) noexcept: p_(&p) { p.pending_ = &pending_; }
+
+    coro_return(const coro_return&) = delete;
+    coro_return& operator=(const coro_return&) = delete;
+
+    // called from the constructor of the result object
+    void bind(R& r) {
+        if (pending_) r = std::move(*pending_);
+        else p_->slot_ = &r;
+    }
+
+private:
+    coro_promise<R>* p_;
+    std::optional<R> pending_;
+};
+
+// Awaiting an expected x: if x has an error, the error is written to the
+// result and the frame destroyed, returning control to the caller.
+
+template <typename X, typename R>
+struct coro_awaiter {
+    using source_type = std::remove_cv_t<std::remove_reference_t<X>>;
+    using value_type = typename source_type::value_type;
+
+    // the value is passed on by reference only from an lvalue
+    using result_type = std::conditional_t<
+        std::is_lvalue_reference_v<X> || std::is_void_v<value_type>,
+        decltype(*std::declval<X>()),
+        std::remove_cv_t<value_type>>;
+
+    X x_;
+    coro_promise<R>& p_;
+
+    bool await_ready() const noexcept { return x_.has_value(); }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        p_.return_error(std::forward<X>(x_).error());
+        h.destroy();
+    }
+
+    template <typename V = value_type, std::enable_if_t<!std::is_void_v<V>, int> = 0>
+    result_type await_resume() { return *std::forward<X>(x_); }
+
+    template <typename V = value_type, std::enable_if_t<std::is_void_v<V>, int> = 0>
+    void await_resume() const noexcept {}
+};
+
+template <typename R>
+template <typename X>
+auto coro_promise<R>::await_transform(X&& x) noexcept {
+    static_assert(is_expected_v<std::remove_cv_t<std::remove_reference_t<X>>>,
+                  "only expected may be awaited in a coroutine returning expected");
+    return coro_awaiter<X&&, R>{std::forward<X>(x), *this};
+}
+
+// Promise for coroutines taking (std::allocator_arg_t, const Alloc&, ...):
+// the frame is followed by the allocator that allocated it.
+
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) coro_block {
+    unsigned char bytes[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+};
+
+template <typename R, typename Alloc>
+struct coro_alloc_promise: coro_promise<R> {
+    using block_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<coro_block>;
+    using block_traits = std::allocator_traits<block_alloc>;
+
+    static_assert(alignof(block_alloc)<=alignof(coro_block), "over-aligned allocator");
+    static_assert(std::is_same_v<typename block_traits::pointer, coro_block*>, "allocator must use raw pointers");
+
+    static constexpr std::size_t alloc_offset(std::size_t n) noexcept {
+        return (n+alignof(block_alloc)-1)/alignof(block_alloc)*alignof(block_alloc);
+    }
+
+    static constexpr std::size_t n_blocks(std::size_t n) noexcept {
+        return (alloc_offset(n)+sizeof(block_alloc)+sizeof(coro_block)-1)/sizeof(coro_block);
+    }
+
+    static block_alloc* stored_alloc(void* p, std::size_t n) noexcept {
+        return std::launder(reinterpret_cast<block_alloc*>(static_cast<unsigned char*>(p)+alloc_offset(n)));
+    }
+
+    template <typename... Args>
+    static void* operator new(std::size_t n, std::allocator_arg_t, const Alloc& alloc, Args&...) {
+        block_alloc a(alloc);
+        coro_block* p = block_traits::allocate(a, n_blocks(n));
+        ::new (static_cast<void*>(reinterpret_cast<unsigned char*>(p)+alloc_offset(n))) block_alloc(std::move(a));
+        return p;
+    }
+
+    static void operator delete(void* p, std::size_t n) noexcept {
+        block_alloc* stored = stored_alloc(p, n);
+        block_alloc a(std::move(*stored));
+        stored->~block_alloc();
+        block_traits::deallocate(a, static_cast<coro_block*>(p), n_blocks(n));
+    }
+};
+
+template <typename R, typename... Args>
+struct coro_promise_select {
+    using type = coro_promise<R>;
+};
+
+template <typename R, typename Alloc, typename... Args>
+struct coro_promise_select<R, std::allocator_arg_t, Alloc, Args...> {
+    using type = coro_alloc_promise<R, Alloc>;
+};
+
+} // namespace detail
+
+} // namespace backport
+
+template <typename T, typename E, bool V, typename... Args>
+struct std::coroutine_traits<backport::expected<T, E, V>, Args...> {
+    using promise_type = typename backport::detail::coro_promise_select<
+        backport::expected<T, E, V>, std::remove_cv_t<std::remove_reference_t<Args>>...>::type;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+// Forward declarations for expected
+//
+// Declares expected, unexpected and boxed, and defines unexpect_t and
+// unexpect, without including any standard library header. This is enough
+// to name expected<T, E> in declarations, and to pass and return it by
+// reference; anything that needs the complete types requires expected.h.
+
+namespace backport {
+
+namespace detail {
+
+// std::is_void, for the default argument of expected
+template <typename T> struct fwd_is_void { static constexpr bool value = false; };
+template <> struct fwd_is_void<void> { static constexpr bool value = true; };
+template <> struct fwd_is_void<const void> { static constexpr bool value = true; };
+template <> struct fwd_is_void<volatile void> { static constexpr bool value = true; };
+template <> struct fwd_is_void<const volatile void> { static constexpr bool value = true; };
+
+} // namespace detail
+
+struct unexpect_t { explicit unexpect_t() = default; };
+inline constexpr unexpect_t unexpect{};
+
+template <typename E>
+struct unexpected;
+
+template <typename E>
+struct boxed;
+
+template <typename T, typename E, bool = detail::fwd_is_void<T>::value>
+struct expected;
+
+} // namespace backport
@@ -0,0 +1,208 @@
+#pragma once
+
+// Fixed-width batch of N expected<T, E> lanes
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <backport/expected.h>
+
+namespace backport {
+
+// expected_simd<T, E, N> holds N values, a lane mask recording which lanes
+// hold a value, and N errors, each as a separate array. A value lane holds a
+// value-initialized E, and an error lane a valid but unspecified T.
+//
+// The monadic operations mirror those of expected but apply their function to
+// every lane, so that the loop over lanes reduces to selects and can be
+// vectorized; results in error lanes are discarded. Functions passed to
+// transform, and_then, or_else and transform_error should therefore be free
+// of side effects and valid for any value of their argument type.
+
+template <typename T, typename E, std::size_t N>
+class expected_simd {
+    static_assert(N>0, "batch width must be positive");
+    static_assert(std::is_default_constructible_v<T> && std::is_default_constructible_v<E>,
+                  "value and error types must be default constructible");
+
+public:
+    using value_type = T;
+    using error_type = E;
+    using mask_type = std::array<bool, N>;
+
+    template <typename U, typename G = E>
+    using rebind = expected_simd<U, G, N>;
+
+    static constexpr std::size_t size() noexcept { return N; }
+
+    // all lanes value-initialized values
+    constexpr expected_simd(): vals_{}, mask_{}, errs_{} {
+        for (std::size_t i = 0; i<N; ++i) mask_[i] = true;
+    }
+
+    // all lanes values
+    constexpr expected_simd(const std::array<T, N>& vals): vals_(vals), mask_{}, errs_{} {
+        for (std::size_t i = 0; i<N; ++i) mask_[i] = true;
+    }
+
+    // all lanes the same value
+    constexpr explicit expected_simd(const T& v): vals_{}, mask_{}, errs_{} {
+        for (std::size_t i = 0; i<N; ++i) {
+            vals_[i] = v;
+            mask_[i] = true;
+        }
+    }
+
+    constexpr expected_simd(const std::array<T, N>& vals, const mask_type& mask, const std::array<E, N>& errs):
+        vals_(vals), mask_(mask), errs_(errs) {}
+
+    // gather from N consecutive expected objects
+    template <typename U, typename G>
+    constexpr explicit expected_simd(const expected<U, G>* p): vals_{}, mask_{}, errs_{} {
+        for (std::size_t i = 0; i<N; ++i) {
+            mask_[i] = p[i].has_value();
+            if (mask_[i]) vals_[i] = *p[i];
+            else errs_[i] = p[i].error();
+        }
+    }
+
+    // lane access
+
+    constexpr bool has_value(std::size_t i) const noexcept { return mask_[i]; }
+
+    constexpr expected<T, E> operator[](std::size_t i) const {
+        return mask_[i]? expected<T, E>(std::in_place, vals_[i]): expected<T, E>(unexpect, errs_[i]);
+    }
+
+    constexpr void set_value(std::size_t i, T v) {
+        vals_[i] = std::move(v);
+        errs_[i] = E{};
+        mask_[i] = true;
+    }
+
+    constexpr void set_error(std::size_t i, E e) {
+        errs_[i] = std::move(e);
+        mask_[i] = false;
+    }
+
+    // scatter to N consecutive expected objects
+    template <typename U, typename G>
+    constexpr void store(expected<U, G>* p) const {
+        for (std::size_t i = 0; i<N; ++i) p[i] = (*this)[i];
+    }
+
+    constexpr const std::array<T, N>& values() const noexcept { return vals_; }
+    constexpr const mask_type& mask() const noexcept { return mask_; }
+    constexpr const std::array<E, N>& errors() const noexcept { return errs_; }
+
+    // mask queries
+
+    constexpr bool all_values() const noexcept {
+        bool r = true;
+        for (std::size_t i = 0; i<N; ++i) r &= mask_[i];
+        return r;
+    }
+
+    constexpr bool any_value() const noexcept {
+        bool r = false;
+        for (std::size_t i = 0; i<N; ++i) r |= mask_[i];
+        return r;
+    }
+
+    constexpr std::size_t count_values() const noexcept {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i<N; ++i) n += mask_[i];
+        return n;
+    }
+
+    // blends
+
+    template <typename U>
+    constexpr std::array<T, N> value_or(U&& alt) const {
+        T a(std::forward<U>(alt));
+        std::array<T, N> r{};
+        for (std::size_t i = 0; i<N; ++i) r[i] = mask_[i]? vals_[i]: a;
+        return r;
+    }
+
+    template <typename G>
+    constexpr std::array<E, N> error_or(G&& alt) const {
+        E a(std::forward<G>(alt));
+        std::array<E, N> r{};
+        for (std::size_t i = 0; i<N; ++i) r[i] = mask_[i]? a: errs_[i];
+        return r;
+    }
+
+    // monadic operations
+
+    template <typename F>
+    constexpr auto transform(F&& f) const {
+        using U = std::remove_cv_t<std::invoke_result_t<F&, const T&>>;
+        expected_simd<U, E, N> r;
+        for (std::size_t i = 0; i<N; ++i) r.vals_[i] = detail::invoke(f, vals_[i]);
+        r.mask_ = mask_;
+        r.errs_ = errs_;
+        return r;
+    }
+
+    template <typename F>
+    constexpr auto and_then(F&& f) const {
+        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F&, const T&>>>;
+        static_assert(detail::is_expected_v<R> && std::is_same_v<typename R::error_type, E>,
+                      "and_then function must return expected with the same error type");
+        using U = typename R::value_type;
+
+        expected_simd<U, E, N> r;
+        for (std::size_t i = 0; i<N; ++i) {
+            R x = detail::invoke(f, vals_[i]);
+            r.mask_[i] = mask_[i] && x.has_value();
+            if (!mask_[i]) r.errs_[i] = errs_[i];
+            else if (x.has_value()) r.vals_[i] = *std::move(x);
+            else r.errs_[i] = std::move(x).error();
+        }
+        return r;
+    }
+
+    template <typename F>
+    constexpr auto or_else(F&& f) const {
+        using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F&, const E&>>>;
+        static_assert(detail::is_expected_v<R> && std::is_same_v<typename R::value_type, T>,
+                      "or_else function must return expected with the same value type");
+        using G = typename R::error_type;
+
+        expected_simd<T, G, N> r;
+        for (std::size_t i = 0; i<N; ++i) {
+            R x = detail::invoke(f, errs_[i]);
+            r.mask_[i] = mask_[i] || x.has_value();
+            if (mask_[i]) r.vals_[i] = vals_[i];
+            else if (x.has_value()) r.vals_[i] = *std::move(x);
+            else r.errs_[i] = std::move(x).error();
+        }
+        return r;
+    }
+
+    template <typename F>
+    constexpr auto transform_error(F&& f) const {
+        using G = std::remove_cv_t<std::invoke_result_t<F&, const E&>>;
+        expected_simd<T, G, N> r;
+        for (std::size_t i = 0; i<N; ++i) {
+            G g = detail::invoke(f, errs_[i]);
+            r.errs_[i] = mask_[i]? G{}: std::move(g);
+        }
+        r.vals_ = vals_;
+        r.mask_ = mask_;
+        return r;
+    }
+
+private:
+    template <typename, typename, std::size_t>
+    friend class expected_simd;
+
+    std::array<T, N> vals_;
+    mask_type mask_;
+    std::array<E, N> errs_;
+};
+
+} // namespace backport
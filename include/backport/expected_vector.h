@@ -0,0 +1,321 @@
+#pragma once
+
+// Structure-of-arrays container for sequences of expected<T, E>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <backport/expected.h>
+
+namespace backport {
+
+// expected_vector<T, E> holds a sequence of expected<T, E> as
+//   * a contiguous array of T, with a value-initialized T at each error
+//     position;
+//   * a bitmask, one bit per element, set where the element has a value;
+//   * a side table of (index, E) pairs sorted by index, holding the errors.
+//
+// Element access is through proxy references that behave like
+// expected<T, E>&.
+//
+// Appending is amortized constant time. Assigning an error to an element
+// that holds a value, or a value to an element that holds an error, inserts
+// into or erases from the side table, and so takes time linear in the number
+// of errors after the element.
+
+template <typename T, typename E>
+class expected_vector {
+    static_assert(std::is_object_v<T> && !std::is_array_v<T>, "value type must be a non-array object type");
+    static_assert(!std::is_same_v<std::remove_cv_t<T>, bool>, "value type may not be bool");
+    static_assert(std::is_default_constructible_v<T>, "value type must be default constructible");
+
+public:
+    using value_type = expected<T, E>;
+    using size_type = std::size_t;
+    using mask_word = std::uint64_t;
+
+    static constexpr size_type mask_bits = 64;
+
+    // contiguous read-only view
+
+    template <typename U>
+    struct view {
+        constexpr const U* data() const noexcept { return data_; }
+        constexpr size_type size() const noexcept { return size_; }
+        constexpr bool empty() const noexcept { return !size_; }
+
+        constexpr const U* begin() const noexcept { return data_; }
+        constexpr const U* end() const noexcept { return data_+size_; }
+
+        constexpr const U& operator[](size_type i) const noexcept { return data_[i]; }
+
+        const U* data_;
+        size_type size_;
+    };
+
+    // proxy references
+
+    class const_reference {
+    public:
+        bool has_value() const noexcept { return v_->has_value(i_); }
+        explicit operator bool() const noexcept { return has_value(); }
+
+        const T& operator*() const noexcept { return v_->values_[i_]; }
+        const T* operator->() const noexcept { return &v_->values_[i_]; }
+
+        const T& value() const {
+            if (!has_value()) detail::throw_failure(bad_expected_access(error()));
+            return **this;
+        }
+
+        const E& error() const noexcept { return v_->find_error(i_)->second; }
+
+        operator value_type() const {
+            return has_value()? value_type(std::in_place, **this): value_type(unexpect, error());
+        }
+
+    private:
+        friend class expected_vector;
+        const_reference(const expected_vector* v, size_type i) noexcept: v_(v), i_(i) {}
+
+        const expected_vector* v_;
+        size_type i_;
+    };
+
+    class reference {
+    public:
+        bool has_value() const noexcept { return v_->has_value(i_); }
+        explicit operator bool() const noexcept { return has_value(); }
+
+        T& operator*() const noexcept { return v_->values_[i_]; }
+        T* operator->() const noexcept { return &v_->values_[i_]; }
+
+        T& value() const {
+            if (!has_value()) detail::throw_failure(bad_expected_access(std::as_const(error())));
+            return **this;
+        }
+
+        E& error() const noexcept { return v_->find_error(i_)->second; }
+
+        operator value_type() const { return value_type(const_reference(v_, i_)); }
+        operator const_reference() const noexcept { return const_reference(v_, i_); }
+
+        // assignment writes through to the element
+
+        const reference& operator=(const value_type& x) const {
+            if (x) v_->set_value(i_, *x);
+            else v_->set_error(i_, x.error());
+            return *this;
+        }
+
+        const reference& operator=(value_type&& x) const {
+            if (x) v_->set_value(i_, std::move(*x));
+            else v_->set_error(i_, std::move(x.error()));
+            return *this;
+        }
+
+        const reference& operator=(const reference& r) const { return *this = value_type(r); }
+
+    private:
+        friend class expected_vector;
+        reference(expected_vector* v, size_type i) noexcept: v_(v), i_(i) {}
+
+        expected_vector* v_;
+        size_type i_;
+    };
+
+    // iterators yield proxy references
+
+    template <typename R, typename V>
+    class basic_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = expected<T, E>;
+        using difference_type = std::ptrdiff_t;
+        using reference = R;
+        using pointer = void;
+
+        R operator*() const noexcept { return R(v_, i_); }
+
+        basic_iterator& operator++() noexcept { ++i_; return *this; }
+        basic_iterator operator++(int) noexcept { auto x = *this; ++i_; return x; }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept { return a.i_==b.i_; }
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) noexcept { return a.i_!=b.i_; }
+
+    private:
+        friend class expected_vector;
+        basic_iterator(V* v, size_type i) noexcept: v_(v), i_(i) {}
+
+        V* v_;
+        size_type i_;
+    };
+
+    using iterator = basic_iterator<reference, expected_vector>;
+    using const_iterator = basic_iterator<const_reference, const expected_vector>;
+
+    expected_vector() = default;
+
+    template <typename InIter>
+    expected_vector(InIter b, InIter e) {
+        for (; b!=e; ++b) push_back(*b);
+    }
+
+    expected_vector(std::initializer_list<value_type> il): expected_vector(il.begin(), il.end()) {}
+
+    // capacity
+
+    size_type size() const noexcept { return values_.size(); }
+    bool empty() const noexcept { return values_.empty(); }
+
+    void reserve(size_type n) {
+        values_.reserve(n);
+        mask_.reserve((n+mask_bits-1)/mask_bits);
+    }
+
+    void clear() noexcept {
+        values_.clear();
+        mask_.clear();
+        errors_.clear();
+    }
+
+    // modifiers
+
+    void push_back(const value_type& x) {
+        if (x) emplace_back(*x);
+        else push_back_error(x.error());
+    }
+
+    void push_back(value_type&& x) {
+        if (x) emplace_back(std::move(*x));
+        else push_back_error(std::move(x.error()));
+    }
+
+    // If constructing the element throws, the vector is unchanged.
+
+    template <typename... As>
+    T& emplace_back(As&&... as) {
+        bool new_word = reserve_bit();
+        BACKPORT_EXPECTED_TRY {
+            values_.emplace_back(std::forward<As>(as)...);
+        }
+        BACKPORT_EXPECTED_CATCH_ALL {
+            if (new_word) mask_.pop_back();
+            BACKPORT_EXPECTED_RETHROW;
+        }
+        set_bit(size()-1);
+        return values_.back();
+    }
+
+    template <typename... As>
+    E& push_back_error(As&&... as) {
+        bool new_word = reserve_bit();
+        bool new_error = false;
+        BACKPORT_EXPECTED_TRY {
+            errors_.emplace_back(std::piecewise_construct, std::forward_as_tuple(size()), std::forward_as_tuple(std::forward<As>(as)...));
+            new_error = true;
+            values_.emplace_back();
+        }
+        BACKPORT_EXPECTED_CATCH_ALL {
+            if (new_error) errors_.pop_back();
+            if (new_word) mask_.pop_back();
+            BACKPORT_EXPECTED_RETHROW;
+        }
+        return errors_.back().second;
+    }
+
+    void pop_back() noexcept {
+        if (!has_value(size()-1)) errors_.pop_back();
+        clear_bit(size()-1);
+        values_.pop_back();
+        if (size()%mask_bits==0) mask_.pop_back();
+    }
+
+    // element access
+
+    reference operator[](size_type i) noexcept { return reference(this, i); }
+    const_reference operator[](size_type i) const noexcept { return const_reference(this, i); }
+
+    iterator begin() noexcept { return iterator(this, 0); }
+    iterator end() noexcept { return iterator(this, size()); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(this, size()); }
+
+    bool has_value(size_type i) const noexcept { return mask_[i/mask_bits]>>(i%mask_bits) & 1u; }
+
+    // bulk queries
+
+    // Errors are held in index order, so counting and finding the first error
+    // need only the side table, and take constant time; the price is paid on
+    // assignment through a reference (see above).
+
+    size_type count_errors() const noexcept { return errors_.size(); }
+    size_type count_values() const noexcept { return size()-errors_.size(); }
+
+    // index of the first error, or size() if there is none
+    size_type first_error() const noexcept { return errors_.empty()? size(): errors_.front().first; }
+
+    // All values, including the value-initialized T at each error position.
+    view<T> values_span() const noexcept { return {values_.data(), values_.size()}; }
+
+    // Bit i%64 of word i/64 is set if and only if element i has a value; bits
+    // beyond size() are zero.
+    view<mask_word> value_mask() const noexcept { return {mask_.data(), mask_.size()}; }
+
+    // (index, error) pairs in index order
+    view<std::pair<size_type, E>> errors() const noexcept { return {errors_.data(), errors_.size()}; }
+
+private:
+    std::vector<T> values_;
+    std::vector<mask_word> mask_;
+    std::vector<std::pair<size_type, E>> errors_;
+
+    // Make room in the mask for one more element; returns true if a word was
+    // added, to be removed if the element is not constructed.
+    bool reserve_bit() {
+        if (mask_.size()*mask_bits!=size()) return false;
+        mask_.push_back(0);
+        return true;
+    }
+
+    void set_bit(size_type i) noexcept { mask_[i/mask_bits] |= mask_word(1)<<(i%mask_bits); }
+    void clear_bit(size_type i) noexcept { mask_[i/mask_bits] &= ~(mask_word(1)<<(i%mask_bits)); }
+
+    auto find_error(size_type i) noexcept {
+        return std::lower_bound(errors_.begin(), errors_.end(), i, [](auto& p, size_type i) { return p.first<i; });
+    }
+
+    auto find_error(size_type i) const noexcept {
+        return std::lower_bound(errors_.begin(), errors_.end(), i, [](auto& p, size_type i) { return p.first<i; });
+    }
+
+    template <typename U>
+    void set_value(size_type i, U&& u) {
+        values_[i] = std::forward<U>(u);
+        if (!has_value(i)) {
+            errors_.erase(find_error(i));
+            set_bit(i);
+        }
+    }
+
+    template <typename G>
+    void set_error(size_type i, G&& g) {
+        if (!has_value(i)) {
+            find_error(i)->second = std::forward<G>(g);
+        }
+        else {
+            errors_.emplace(find_error(i), std::piecewise_construct, std::forward_as_tuple(i), std::forward_as_tuple(std::forward<G>(g)));
+            clear_bit(i);
+            values_[i] = T();
+        }
+    }
+};
+
+} // namespace backport
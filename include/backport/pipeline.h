@@ -0,0 +1,252 @@
+#pragma once
+
+// Lazy, fused chains of monadic operations on expected
+//
+//     expected<R, G> r = e | and_then(f) | transform(g) | or_else(h);
+//
+// builds a pipeline holding a reference to e and the functions, and evaluates
+// it on conversion to its result type or on run(); as with other expression
+// templates, a pipeline on a temporary must be evaluated within the same full
+// expression. Evaluation passes each intermediate value or error
+// directly to the next function that needs it: apart from the expected
+// objects returned by the functions passed to and_then and or_else, no
+// intermediate expected objects are constructed, and only the final result is
+// built from the last value or error. As with the member functions, a final
+// transform or transform_error constructs its result in place.
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <backport/expected.h>
+
+namespace backport {
+
+namespace detail {
+
+enum class pipe_op { and_then, or_else, transform, transform_error };
+
+template <pipe_op Op, typename F>
+struct pipe_step {
+    F f;
+};
+
+template <typename S, pipe_op Op>
+inline constexpr bool is_pipe_op_v = false;
+
+template <pipe_op Op, typename F>
+inline constexpr bool is_pipe_op_v<pipe_step<Op, F>, Op> = true;
+
+template <typename... As>
+struct pipe_args {};
+
+template <typename V>
+using pipe_value_args = std::conditional_t<std::is_void_v<V>, pipe_args<>, pipe_args<V>>;
+
+// Result type of a pipeline: V, G are the value and error types of the
+// expected at the current step, Args the value (if any) as passed to the next
+// function, and Ge the error as passed.
+
+template <typename V, typename G, typename Args, typename Ge, typename... Steps>
+struct pipe_result {
+    using type = expected<V, G>;
+};
+
+template <typename V, typename G, typename... As, typename Ge, typename F, typename... Steps>
+struct pipe_result<V, G, pipe_args<As...>, Ge, pipe_step<pipe_op::and_then, F>, Steps...> {
+    using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F&, As...>>>;
+    static_assert(is_expected_v<R>, "and_then function must return an expected");
+
+    using type = typename pipe_result<
+        typename R::value_type, typename R::error_type,
+        pipe_value_args<typename R::value_type>, Ge, Steps...>::type;
+};
+
+template <typename V, typename G, typename... As, typename Ge, typename F, typename... Steps>
+struct pipe_result<V, G, pipe_args<As...>, Ge, pipe_step<pipe_op::or_else, F>, Steps...> {
+    using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F&, Ge>>>;
+    static_assert(is_expected_v<R>, "or_else function must return an expected");
+
+    using type = typename pipe_result<
+        typename R::value_type, typename R::error_type,
+        pipe_args<As...>, typename R::error_type, Steps...>::type;
+};
+
+template <typename V, typename G, typename... As, typename Ge, typename F, typename... Steps>
+struct pipe_result<V, G, pipe_args<As...>, Ge, pipe_step<pipe_op::transform, F>, Steps...> {
+    using U = std::invoke_result_t<F&, As...>;
+
+    using type = typename pipe_result<
+        transform_result_t<U>, G,
+        pipe_value_args<U>, Ge, Steps...>::type;
+};
+
+template <typename V, typename G, typename... As, typename Ge, typename F, typename... Steps>
+struct pipe_result<V, G, pipe_args<As...>, Ge, pipe_step<pipe_op::transform_error, F>, Steps...> {
+    using H = std::remove_cv_t<std::invoke_result_t<F&, Ge>>;
+
+    using type = typename pipe_result<V, H, pipe_args<As...>, H, Steps...>::type;
+};
+
+// Evaluation from step I with a value (as, empty if void) or with an error g.
+
+template <typename Result, typename Steps, std::size_t I = 0>
+struct pipe_eval {
+    using next = pipe_eval<Result, Steps, I+1>;
+
+    template <typename... As>
+    static constexpr Result value(Steps& steps, As&&... as) {
+        if constexpr (I==std::tuple_size_v<Steps>) {
+            return Result(std::in_place, std::forward<As>(as)...);
+        }
+        else {
+            auto& step = std::get<I>(steps);
+            using step_type = std::remove_reference_t<decltype(step)>;
+
+            if constexpr (is_pipe_op_v<step_type, pipe_op::and_then>) {
+                auto&& r = detail::invoke(step.f, std::forward<As>(as)...);
+                if (!r.has_value()) return next::error(steps, std::move(r).error());
+                if constexpr (std::is_void_v<typename std::remove_reference_t<decltype(r)>::value_type>) {
+                    return next::value(steps);
+                }
+                else {
+                    return next::value(steps, *std::move(r));
+                }
+            }
+            else if constexpr (is_pipe_op_v<step_type, pipe_op::transform>) {
+                if constexpr (std::is_void_v<decltype(detail::invoke(step.f, std::forward<As>(as)...))>) {
+                    detail::invoke(step.f, std::forward<As>(as)...);
+                    return next::value(steps);
+                }
+                else if constexpr (I+1==std::tuple_size_v<Steps>) {
+                    return Result(in_place_invoke, step.f, std::forward<As>(as)...);
+                }
+                else {
+                    return next::value(steps, detail::invoke(step.f, std::forward<As>(as)...));
+                }
+            }
+            else {
+                return next::value(steps, std::forward<As>(as)...);
+            }
+        }
+    }
+
+    template <typename G>
+    static constexpr Result error(Steps& steps, G&& g) {
+        if constexpr (I==std::tuple_size_v<Steps>) {
+            return Result(unexpect, std::forward<G>(g));
+        }
+        else {
+            auto& step = std::get<I>(steps);
+            using step_type = std::remove_reference_t<decltype(step)>;
+
+            if constexpr (is_pipe_op_v<step_type, pipe_op::or_else>) {
+                auto&& r = detail::invoke(step.f, std::forward<G>(g));
+                if (!r.has_value()) return next::error(steps, std::move(r).error());
+                if constexpr (std::is_void_v<typename std::remove_reference_t<decltype(r)>::value_type>) {
+                    return next::value(steps);
+                }
+                else {
+                    return next::value(steps, *std::move(r));
+                }
+            }
+            else if constexpr (is_pipe_op_v<step_type, pipe_op::transform_error>) {
+                if constexpr (I+1==std::tuple_size_v<Steps>) {
+                    return Result(unexpect_invoke, step.f, std::forward<G>(g));
+                }
+                else {
+                    return next::error(steps, detail::invoke(step.f, std::forward<G>(g)));
+                }
+            }
+            else {
+                return next::error(steps, std::forward<G>(g));
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+// Src is an lvalue or rvalue reference to the source expected, through which
+// the source value or error is passed to the first step. A pipeline is
+// consumed by its evaluation, and so is evaluated only as an rvalue.
+
+template <typename Src, typename... Steps>
+class pipeline {
+    using source_type = std::remove_cv_t<std::remove_reference_t<Src>>;
+    using T = typename source_type::value_type;
+    using E = typename source_type::error_type;
+
+    static_assert(std::is_reference_v<Src>, "pipeline source must be a reference");
+
+    using source_value_args = std::conditional_t<std::is_void_v<T>, detail::pipe_args<>,
+        detail::pipe_args<decltype(*std::declval<Src>())>>;
+
+    using source_error = decltype(std::declval<Src>().error());
+
+public:
+    using result_type = typename detail::pipe_result<T, E, source_value_args, source_error, Steps...>::type;
+
+    constexpr pipeline(Src src, std::tuple<Steps...> steps):
+        src_(std::forward<Src>(src)), steps_(std::move(steps)) {}
+
+    constexpr result_type run() && { return eval(); }
+    constexpr operator result_type() && { return eval(); }
+
+private:
+    template <typename, typename...>
+    friend class pipeline;
+
+    Src src_;
+    std::tuple<Steps...> steps_;
+
+    constexpr result_type eval() {
+        using eval = detail::pipe_eval<result_type, std::tuple<Steps...>>;
+
+        if (!src_.has_value()) return eval::error(steps_, static_cast<Src>(src_).error());
+        if constexpr (std::is_void_v<T>) return eval::value(steps_);
+        else return eval::value(steps_, *static_cast<Src>(src_));
+    }
+
+    template <typename Step>
+    constexpr pipeline<Src, Steps..., Step> append(Step step) && {
+        return {std::forward<Src>(src_), std::tuple_cat(std::move(steps_), std::tuple<Step>(std::move(step)))};
+    }
+
+    template <typename S, typename... Ss, detail::pipe_op Op, typename F>
+    friend constexpr auto operator|(pipeline<S, Ss...>&& p, detail::pipe_step<Op, F> step);
+};
+
+// pipeline steps
+
+template <typename F>
+constexpr detail::pipe_step<detail::pipe_op::and_then, std::decay_t<F>> and_then(F&& f) { return {std::forward<F>(f)}; }
+
+template <typename F>
+constexpr detail::pipe_step<detail::pipe_op::or_else, std::decay_t<F>> or_else(F&& f) { return {std::forward<F>(f)}; }
+
+template <typename F>
+constexpr detail::pipe_step<detail::pipe_op::transform, std::decay_t<F>> transform(F&& f) { return {std::forward<F>(f)}; }
+
+template <typename F>
+constexpr detail::pipe_step<detail::pipe_op::transform_error, std::decay_t<F>> transform_error(F&& f) { return {std::forward<F>(f)}; }
+
+// pipeline construction
+
+template <
+    typename X,
+    detail::pipe_op Op,
+    typename F,
+    std::enable_if_t<detail::is_expected_v<std::remove_cv_t<std::remove_reference_t<X>>>, int> = 0
+>
+constexpr auto operator|(X&& e, detail::pipe_step<Op, F> step) {
+    return pipeline<X&&, detail::pipe_step<Op, F>>(std::forward<X>(e), std::tuple<detail::pipe_step<Op, F>>(std::move(step)));
+}
+
+template <typename S, typename... Ss, detail::pipe_op Op, typename F>
+constexpr auto operator|(pipeline<S, Ss...>&& p, detail::pipe_step<Op, F> step) {
+    return std::move(p).append(std::move(step));
+}
+
+} // namespace backport
@@ -0,0 +1,238 @@
+#pragma once
+
+// Per-thread error counters for the error telemetry hooks
+//
+// Requires BACKPORT_EXPECTED_TELEMETRY to be defined to 1 (see expected.h),
+// consistently across all translation units: in one that uses expected
+// without it, events are not counted, or not reliably so.
+//
+// error_counters::install() sets a telemetry hook that counts, per error type,
+// the events of each kind on the calling thread, in counters owned by that
+// thread: each is written only by its own thread, with relaxed atomic loads
+// and stores and no read-modify-write. snapshot() merges the counters of all
+// threads, including those that have exited, into a text report with one
+// value per line:
+//
+//     backport_expected_errors{type="parse_error",event="unexpected"} 12
+//
+// With a sample period n>0, every nth unexpected constructed on a thread
+// starts a sample, and each later construction on that thread of an expected
+// holding an error of the same type, up to the next unexpected, records the
+// elapsed time since the sample start in a histogram of powers of two
+// nanoseconds:
+//
+//     backport_expected_propagation_ns_bucket{type="parse_error",le="1024"} 3
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <backport/expected.h>
+
+#if !BACKPORT_EXPECTED_TELEMETRY
+#error "backport/telemetry.h requires BACKPORT_EXPECTED_TELEMETRY to be defined to 1"
+#endif
+
+#ifndef BACKPORT_EXPECTED_TELEMETRY_TYPES
+#define BACKPORT_EXPECTED_TELEMETRY_TYPES 64
+#endif
+
+namespace backport {
+
+namespace detail {
+
+inline constexpr std::size_t telemetry_n_events = 3;
+inline constexpr std::size_t telemetry_n_buckets = 40;
+inline constexpr std::size_t telemetry_max_types = BACKPORT_EXPECTED_TELEMETRY_TYPES;
+
+struct telemetry_totals {
+    std::array<std::uint64_t, telemetry_n_events> events{};
+    std::array<std::uint64_t, telemetry_n_buckets> buckets{};
+    std::uint64_t sum_ns = 0;
+};
+
+struct telemetry_slot {
+    std::atomic<const error_type_info*> type{nullptr};
+    std::array<std::atomic<std::uint64_t>, telemetry_n_events> events{};
+    std::array<std::atomic<std::uint64_t>, telemetry_n_buckets> buckets{};
+    std::atomic<std::uint64_t> sum_ns{0};
+
+    void add_to(telemetry_totals& t) const {
+        for (std::size_t i = 0; i<telemetry_n_events; ++i) t.events[i] += events[i].load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i<telemetry_n_buckets; ++i) t.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+        t.sum_ns += sum_ns.load(std::memory_order_relaxed);
+    }
+};
+
+// increment a counter written only by this thread
+inline void telemetry_bump(std::atomic<std::uint64_t>& c, std::uint64_t n = 1) noexcept {
+    c.store(c.load(std::memory_order_relaxed)+n, std::memory_order_relaxed);
+}
+
+struct telemetry_thread;
+
+struct telemetry_registry {
+    std::mutex mex;
+    std::vector<telemetry_thread*> threads;
+
+    // totals from exited threads, and type information by index
+    std::array<telemetry_totals, telemetry_max_types> retired;
+    std::array<const error_type_info*, telemetry_max_types> types{};
+
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<unsigned> sample_period{0};
+
+    static telemetry_registry& get() {
+        static telemetry_registry r;
+        return r;
+    }
+};
+
+struct telemetry_thread {
+    std::array<telemetry_slot, telemetry_max_types> slots;
+
+    // sampling state
+    unsigned tick = 0;
+    const error_type_info* sampled = nullptr;
+    std::chrono::steady_clock::time_point sample_start;
+
+    telemetry_thread() {
+        auto& reg = telemetry_registry::get();
+        std::lock_guard<std::mutex> lock(reg.mex);
+        reg.threads.push_back(this);
+    }
+
+    ~telemetry_thread() {
+        auto& reg = telemetry_registry::get();
+        std::lock_guard<std::mutex> lock(reg.mex);
+        for (std::size_t i = 0; i<telemetry_max_types; ++i) {
+            if (auto t = slots[i].type.load(std::memory_order_relaxed)) {
+                reg.types[i] = t;
+                slots[i].add_to(reg.retired[i]);
+            }
+        }
+        for (auto& p: reg.threads) {
+            if (p==this) {
+                p = reg.threads.back();
+                reg.threads.pop_back();
+                break;
+            }
+        }
+    }
+
+    static telemetry_thread& local() {
+        static thread_local telemetry_thread t;
+        return t;
+    }
+
+    void record(error_event event, const error_type_info& type) {
+        auto& reg = telemetry_registry::get();
+        if (type.index>=telemetry_max_types) {
+            reg.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        telemetry_slot& slot = slots[type.index];
+        if (!slot.type.load(std::memory_order_relaxed)) slot.type.store(&type, std::memory_order_relaxed);
+        telemetry_bump(slot.events[static_cast<std::size_t>(event)]);
+
+        unsigned period = reg.sample_period.load(std::memory_order_relaxed);
+        if (!period) return;
+
+        if (event==error_event::unexpected) {
+            sampled = nullptr;
+            if (++tick>=period) {
+                tick = 0;
+                sampled = &type;
+                sample_start = std::chrono::steady_clock::now();
+            }
+        }
+        else if (event==error_event::expected && sampled==&type) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-sample_start).count();
+            std::uint64_t n = ns>0? std::uint64_t(ns): 0;
+
+            std::size_t b = 0;
+            while (b+1<telemetry_n_buckets && (std::uint64_t(1)<<b)<n) ++b;
+            telemetry_bump(slot.buckets[b]);
+            telemetry_bump(slot.sum_ns, n);
+        }
+    }
+};
+
+inline void telemetry_record(error_event event, const error_type_info& type) {
+    telemetry_thread::local().record(event, type);
+}
+
+} // namespace detail
+
+struct error_counters {
+    // Set the counting hook; with sample_period>0, also sample propagation
+    // times of one in sample_period errors.
+    static void install(unsigned sample_period = 0) {
+        detail::telemetry_registry::get().sample_period.store(sample_period, std::memory_order_relaxed);
+        set_telemetry_hook(detail::telemetry_record);
+    }
+
+    static void uninstall() {
+        set_telemetry_hook(nullptr);
+    }
+
+    // Merged counts for all threads, as text.
+    static std::string snapshot() {
+        using namespace detail;
+        auto& reg = telemetry_registry::get();
+
+        std::array<telemetry_totals, telemetry_max_types> totals;
+        std::array<const error_type_info*, telemetry_max_types> types;
+        {
+            std::lock_guard<std::mutex> lock(reg.mex);
+            totals = reg.retired;
+            types = reg.types;
+            for (auto* t: reg.threads) {
+                for (std::size_t i = 0; i<telemetry_max_types; ++i) {
+                    if (auto ty = t->slots[i].type.load(std::memory_order_relaxed)) {
+                        types[i] = ty;
+                        t->slots[i].add_to(totals[i]);
+                    }
+                }
+            }
+        }
+
+        static constexpr const char* event_names[telemetry_n_events] = {"unexpected", "expected", "transform_error"};
+        bool sampled = reg.sample_period.load(std::memory_order_relaxed)>0;
+
+        std::ostringstream out;
+        for (std::size_t i = 0; i<telemetry_max_types; ++i) {
+            if (!types[i]) continue;
+            std::string_view name = types[i]->name;
+
+            for (std::size_t e = 0; e<telemetry_n_events; ++e) {
+                out << "backport_expected_errors{type=\"" << name << "\",event=\"" << event_names[e] << "\"} "
+                    << totals[i].events[e] << '\n';
+            }
+
+            if (!sampled) continue;
+            std::uint64_t cumulative = 0;
+            for (std::size_t b = 0; b<telemetry_n_buckets; ++b) {
+                cumulative += totals[i].buckets[b];
+                out << "backport_expected_propagation_ns_bucket{type=\"" << name << "\",le=\"";
+                if (b+1<telemetry_n_buckets) out << (std::uint64_t(1)<<b);
+                else out << "+Inf";
+                out << "\"} " << cumulative << '\n';
+            }
+            out << "backport_expected_propagation_ns_sum{type=\"" << name << "\"} " << totals[i].sum_ns << '\n';
+            out << "backport_expected_propagation_ns_count{type=\"" << name << "\"} " << cumulative << '\n';
+        }
+        out << "backport_expected_errors_dropped " << reg.dropped.load(std::memory_order_relaxed) << '\n';
+        return out.str();
+    }
+};
+
+} // namespace backport
@@ -0,0 +1,205 @@
+#pragma once
+
+// Error origin tracing
+//
+// traced<E> is an error type that records where it was created:
+//
+//     expected<int, traced<parse_error>> parse(std::string_view s) {
+//         if (s.empty()) return unexpected_traced(parse_error::empty);
+//         ...
+//     }
+//
+// Tracing is enabled by defining BACKPORT_EXPECTED_TRACE to 1, which must be
+// done consistently across translation units. Otherwise traced<E> is E and
+// unexpected_traced(e) is unexpected(e), so that disabled tracing costs
+// nothing.
+//
+// When enabled, constructing a traced<E> from an E records the source
+// location of the construction, and up to BACKPORT_EXPECTED_TRACE_FRAMES
+// return addresses (default 0), in a fixed-size ring buffer private to the
+// thread; the traced<E> keeps the error and the sequence number of the
+// record. trace() retrieves the record if it is still in the buffer of the
+// calling thread. Copies share the record of the original.
+//
+// The location is that of the expression constructing the traced<E>, so the
+// conversion from E is explicit: an implicit conversion, as in
+// 'return unexpected(e);' from a function returning expected<T, traced<E>>,
+// would take place within expected and record its location instead. Such
+// code does not compile when tracing is enabled; use unexpected_traced(e) or
+// traced<E>(e).
+
+#ifndef BACKPORT_EXPECTED_TRACE
+#define BACKPORT_EXPECTED_TRACE 0
+#endif
+
+#include <type_traits>
+#include <utility>
+
+#include <backport/expected.h>
+
+#if BACKPORT_EXPECTED_TRACE
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BACKPORT_EXPECTED_TRACE_FRAMES
+#define BACKPORT_EXPECTED_TRACE_FRAMES 0
+#endif
+
+#ifndef BACKPORT_EXPECTED_TRACE_BUFFER
+#define BACKPORT_EXPECTED_TRACE_BUFFER 64
+#endif
+
+#if BACKPORT_EXPECTED_TRACE_FRAMES>0 && defined(__has_include)
+#if __has_include(<unwind.h>)
+#include <unwind.h>
+#define BACKPORT_EXPECTED_TRACE_UNWIND 1
+#endif
+#endif
+
+namespace backport {
+
+struct trace_location {
+    const char* file = "";
+    const char* function = "";
+    unsigned line = 0;
+
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+    static constexpr trace_location current(
+        const char* file = __builtin_FILE(),
+        const char* function = __builtin_FUNCTION(),
+        unsigned line = __builtin_LINE()) noexcept
+    {
+        return {file, function, line};
+    }
+#else
+    static constexpr trace_location current() noexcept { return {}; }
+#endif
+};
+
+struct trace_record {
+    std::uint64_t id = 0;
+    trace_location where;
+    std::size_t n_frames = 0;
+    std::array<void*, BACKPORT_EXPECTED_TRACE_FRAMES> frames{};
+};
+
+namespace detail {
+
+struct trace_buffer {
+    static constexpr std::size_t size = BACKPORT_EXPECTED_TRACE_BUFFER;
+    static_assert(size>0, "trace buffer size must be positive");
+
+    std::array<trace_record, size> records;
+    std::uint64_t next_id = 1;
+};
+
+inline thread_local trace_buffer trace_buf;
+
+#if defined(BACKPORT_EXPECTED_TRACE_UNWIND)
+struct trace_unwind_state {
+    trace_record* rec;
+    std::size_t skip;
+};
+
+inline _Unwind_Reason_Code trace_unwind_step(_Unwind_Context* ctx, void* arg) {
+    auto& state = *static_cast<trace_unwind_state*>(arg);
+    if (state.skip) {
+        --state.skip;
+        return _URC_NO_REASON;
+    }
+    if (state.rec->n_frames==state.rec->frames.size()) return _URC_END_OF_STACK;
+
+    state.rec->frames[state.rec->n_frames++] = reinterpret_cast<void*>(_Unwind_GetIP(ctx));
+    return _URC_NO_REASON;
+}
+#endif
+
+inline std::uint64_t trace_capture(const trace_location& where) noexcept {
+    trace_buffer& buf = trace_buf;
+    std::uint64_t id = buf.next_id++;
+
+    trace_record& rec = buf.records[id%trace_buffer::size];
+    rec.id = id;
+    rec.where = where;
+    rec.n_frames = 0;
+
+#if defined(BACKPORT_EXPECTED_TRACE_UNWIND)
+    // skip the frame of trace_capture itself
+    trace_unwind_state state{&rec, 1};
+    _Unwind_Backtrace(trace_unwind_step, &state);
+#endif
+    return id;
+}
+
+inline const trace_record* trace_lookup(std::uint64_t id) noexcept {
+    if (!id) return nullptr;
+    const trace_record& rec = trace_buf.records[id%trace_buffer::size];
+    return rec.id==id? &rec: nullptr;
+}
+
+} // namespace detail
+
+template <typename E>
+class traced {
+public:
+    using error_type = E;
+
+    template <typename G = E, std::enable_if_t<std::is_default_constructible_v<G>, int> = 0>
+    traced() noexcept(std::is_nothrow_default_constructible_v<E>): error_(), id_(0) {}
+
+    explicit traced(const E& e, trace_location where = trace_location::current()):
+        error_(e), id_(detail::trace_capture(where)) {}
+
+    explicit traced(E&& e, trace_location where = trace_location::current()):
+        error_(std::move(e)), id_(detail::trace_capture(where)) {}
+
+    E& get() & noexcept { return error_; }
+    const E& get() const& noexcept { return error_; }
+    E&& get() && noexcept { return std::move(error_); }
+
+    operator const E&() const& noexcept { return error_; }
+
+    // the record of the construction, or null if it has been overwritten or
+    // was made on another thread
+    const trace_record* trace() const noexcept { return detail::trace_lookup(id_); }
+
+    friend bool operator==(const traced& a, const traced& b) { return a.error_==b.error_; }
+    friend bool operator!=(const traced& a, const traced& b) { return a.error_!=b.error_; }
+    friend bool operator==(const traced& a, const E& b) { return a.error_==b; }
+    friend bool operator!=(const traced& a, const E& b) { return a.error_!=b; }
+    friend bool operator==(const E& a, const traced& b) { return a==b.error_; }
+    friend bool operator!=(const E& a, const traced& b) { return a!=b.error_; }
+
+private:
+    E error_;
+    std::uint64_t id_;
+};
+
+template <typename E>
+struct is_trivially_relocatable<traced<E>>: is_trivially_relocatable<E> {};
+
+// unexpected_traced(g): unexpected<traced<G>> recording the caller's location
+template <typename G>
+unexpected<traced<std::decay_t<G>>> unexpected_traced(G&& g, trace_location where = trace_location::current()) {
+    return unexpected<traced<std::decay_t<G>>>(std::in_place, std::forward<G>(g), where);
+}
+
+} // namespace backport
+
+#else // BACKPORT_EXPECTED_TRACE
+
+namespace backport {
+
+template <typename E>
+using traced = E;
+
+template <typename G>
+constexpr unexpected<std::decay_t<G>> unexpected_traced(G&& g) {
+    return unexpected<std::decay_t<G>>(std::forward<G>(g));
+}
+
+} // namespace backport
+
+#endif // BACKPORT_EXPECTED_TRACE
@@ -0,0 +1,91 @@
+#pragma once
+
+// Error propagation macros for functions returning expected
+//
+//     expected<int, std::string> sum(const std::string& a, const std::string& b) {
+//         BACKPORT_TRY(int x, parse(a));
+//         BACKPORT_TRY(int y, parse(b));
+//         return x+y;
+//     }
+//
+// BACKPORT_TRY(var, expr) evaluates the expected expr; if it holds an error,
+// the enclosing function returns unexpected(error), else var (a declaration
+// or an assignable expression) is initialized from or assigned the value.
+// BACKPORT_TRY_VOID(expr) returns the error in the same way and otherwise
+// discards the value.
+//
+// The value and error are moved out of an rvalue expr and copied from an
+// lvalue; the error is moved again into the function result. The value type
+// must be an object type.
+//
+// With GCC and Clang, BACKPORT_TRY uses a statement expression, so that the
+// result of expr is destroyed at the end of the statement; the value is
+// passed to var through the value of the statement expression, at the cost of
+// one further move. Otherwise, or if BACKPORT_TRY_STATEMENT_EXPR is defined to
+// be 0, it expands to several statements, and the result of expr lives to the
+// end of the enclosing block.
+
+#include <type_traits>
+#include <utility>
+
+#include <backport/expected.h>
+
+#ifndef BACKPORT_TRY_STATEMENT_EXPR
+#if defined(__GNUC__) || defined(__clang__)
+#define BACKPORT_TRY_STATEMENT_EXPR 1
+#else
+#define BACKPORT_TRY_STATEMENT_EXPR 0
+#endif
+#endif
+
+namespace backport {
+
+namespace detail {
+
+template <typename X>
+using try_source_t = std::remove_cv_t<std::remove_reference_t<X>>;
+
+template <typename X>
+constexpr unexpected<typename try_source_t<X>::error_type> try_error(X&& x) {
+    static_assert(is_expected_v<try_source_t<X>>, "BACKPORT_TRY requires an expected");
+    return unexpected<typename try_source_t<X>::error_type>(std::forward<X>(x).error());
+}
+
+template <typename X>
+constexpr std::remove_cv_t<typename try_source_t<X>::value_type> try_value(X&& x) {
+    static_assert(std::is_object_v<typename try_source_t<X>::value_type>, "BACKPORT_TRY requires an object value type");
+    return *std::forward<X>(x);
+}
+
+} // namespace detail
+
+} // namespace backport
+
+#define BACKPORT_TRY_CONCAT_(a, b) BACKPORT_TRY_CONCAT2_(a, b)
+#define BACKPORT_TRY_CONCAT2_(a, b) a##b
+
+#define BACKPORT_TRY_STMT_EXPR_(var, ...) \
+    var = __extension__ ({ \
+        auto&& backport_try_r_ = (__VA_ARGS__); \
+        if (!backport_try_r_.has_value()) \
+            return ::backport::detail::try_error(std::forward<decltype(backport_try_r_)>(backport_try_r_)); \
+        ::backport::detail::try_value(std::forward<decltype(backport_try_r_)>(backport_try_r_)); \
+    })
+
+#define BACKPORT_TRY_PORTABLE_(r, var, ...) \
+    auto&& r = (__VA_ARGS__); \
+    if (!r.has_value()) return ::backport::detail::try_error(std::forward<decltype(r)>(r)); \
+    var = ::backport::detail::try_value(std::forward<decltype(r)>(r))
+
+#if BACKPORT_TRY_STATEMENT_EXPR
+#define BACKPORT_TRY(var, ...) BACKPORT_TRY_STMT_EXPR_(var, __VA_ARGS__)
+#else
+#define BACKPORT_TRY(var, ...) BACKPORT_TRY_PORTABLE_(BACKPORT_TRY_CONCAT_(backport_try_r_, __LINE__), var, __VA_ARGS__)
+#endif
+
+#define BACKPORT_TRY_VOID(...) \
+    do { \
+        auto&& backport_try_r_ = (__VA_ARGS__); \
+        if (!backport_try_r_.has_value()) \
+            return ::backport::detail::try_error(std::forward<decltype(backport_try_r_)>(backport_try_r_)); \
+    } while (0)
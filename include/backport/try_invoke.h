@@ -0,0 +1,105 @@
+#pragma once
+
+// Conversion between exceptions and expected at API boundaries
+//
+// try_invoke<E>(f, as...) invokes f(as...) and returns its result as
+// expected<R, E>, with any exception thrown translated to an error of type E
+// by exception_translator<E>; try_invoke_with(translate, f, as...) uses the
+// given translator instead. value_or_throw(x, factory) goes the other way,
+// returning the value of x or throwing factory(x.error()).
+//
+// On the non-throwing path the cost is that of the call and the construction
+// of the result; a translator is invoked only from within the handler, where
+// it may rethrow with 'throw;' to classify the exception.
+
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+#include <backport/expected.h>
+
+namespace backport {
+
+// exception_translator<E> is a customization point: a specialization provides
+// a call operator, invoked from within a catch (...) handler, that returns
+// the error for the current exception.
+
+template <typename E>
+struct exception_translator;
+
+// std::exception_ptr errors capture the exception itself, without rethrowing.
+template <>
+struct exception_translator<std::exception_ptr> {
+    std::exception_ptr operator()() const noexcept { return std::current_exception(); }
+};
+
+namespace detail {
+
+template <typename F, typename... As>
+using try_invoke_value_t = transform_result_t<std::invoke_result_t<F, As...>>;
+
+// Constructs the value of the result in place from f(as...), as transform
+// does, so that a prvalue result is not moved.
+struct try_invoke_eval {
+    template <typename R, typename F, typename... As>
+    static constexpr R value(F&& f, As&&... as) {
+        return R(in_place_invoke, std::forward<F>(f), std::forward<As>(as)...);
+    }
+};
+
+} // namespace detail
+
+template <typename E, typename Translate, typename F, typename... As>
+expected<detail::try_invoke_value_t<F, As...>, E> try_invoke_with(Translate&& translate, F&& f, As&&... as) {
+    using R = expected<detail::try_invoke_value_t<F, As...>, E>;
+
+    BACKPORT_EXPECTED_TRY {
+        if constexpr (std::is_void_v<typename R::value_type>) {
+            detail::invoke(std::forward<F>(f), std::forward<As>(as)...);
+            return R();
+        }
+        else {
+            return detail::try_invoke_eval::value<R>(std::forward<F>(f), std::forward<As>(as)...);
+        }
+    }
+    BACKPORT_EXPECTED_CATCH_ALL {
+        return R(unexpect, std::forward<Translate>(translate)());
+    }
+}
+
+template <typename E, typename F, typename... As>
+expected<detail::try_invoke_value_t<F, As...>, E> try_invoke(F&& f, As&&... as) {
+    return try_invoke_with<E>(exception_translator<E>{}, std::forward<F>(f), std::forward<As>(as)...);
+}
+
+// value_or_throw(x, factory): the value of x, or else throw factory(error),
+// where error is passed with the value category of x.
+
+template <
+    typename X,
+    typename Factory,
+    std::enable_if_t<detail::is_expected_v<std::remove_cv_t<std::remove_reference_t<X>>>, int> = 0
+>
+constexpr decltype(auto) value_or_throw(X&& x, Factory&& factory) {
+    if (!x.has_value()) detail::throw_failure(detail::invoke(std::forward<Factory>(factory), std::forward<X>(x).error()));
+    if constexpr (!std::is_void_v<typename std::remove_reference_t<X>::value_type>) return *std::forward<X>(x);
+}
+
+// value_or_throw(x): the value of x, or else rethrow an error of type
+// std::exception_ptr or throw bad_expected_access for any other error.
+
+template <
+    typename X,
+    std::enable_if_t<detail::is_expected_v<std::remove_cv_t<std::remove_reference_t<X>>>, int> = 0
+>
+constexpr decltype(auto) value_or_throw(X&& x) {
+#if BACKPORT_EXPECTED_EXCEPTIONS
+    using E = typename std::remove_reference_t<X>::error_type;
+    if constexpr (std::is_same_v<E, std::exception_ptr>) {
+        if (!x.has_value()) std::rethrow_exception(x.error());
+    }
+#endif
+    return std::forward<X>(x).value();
+}
+
+} // namespace backport
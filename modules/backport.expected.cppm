@@ -0,0 +1,50 @@
+// Module interface unit for backport.expected (C++20)
+//
+// backport/expected.h is included in the global module fragment, so that it
+// and the standard library headers it includes are not attached to the
+// module, and its public names are exported with using-declarations; the
+// implementation in backport::detail is not exported. Keep the list below in
+// step with expected.h.
+//
+// Macros are not exported: the configuration macros (BACKPORT_EXPECTED_*)
+// take effect only if defined when this unit is compiled, and the contract
+// and propagation macros require the headers.
+//
+// The target test-module builds this unit and an importer
+// (test/module/import_expected.cc).
+
+module;
+
+#include <backport/expected.h>
+
+export module backport.expected;
+
+export namespace backport {
+
+using backport::bad_expected_access;
+using backport::failure_handler;
+using backport::set_failure_handler;
+
+#if BACKPORT_EXPECTED_TELEMETRY
+using backport::error_event;
+using backport::error_type_info;
+using backport::error_type_of;
+using backport::telemetry_hook;
+using backport::set_telemetry_hook;
+#endif
+
+using backport::unexpect_t;
+using backport::unexpect;
+using backport::unexpected;
+using backport::expected;
+using backport::boxed;
+
+using backport::niche_traits;
+using backport::niche_value_traits;
+using backport::aligned_pointer_niche_traits;
+
+using backport::is_trivially_relocatable;
+using backport::is_trivially_relocatable_v;
+using backport::relocate_n;
+
+} // namespace backport
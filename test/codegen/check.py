@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""Check properties of the code generated for small translation units.
+
+usage: check.py [--cxx CXX] [--std STD] [--flag FLAG ...] SOURCE...
+
+Each source lists its expectations in comments of the form
+
+    // CODEGEN <function>: <property>...
+
+where <function> is an extern "C" function defined in the source, and each
+property is one of:
+
+    no-call     no calls, and no jumps to other functions, outside of any
+                outlined cold part <function>.cold
+    no-throw    no references to exception throwing functions or to the
+                bad_*_access exception types, including in <function>.cold
+    no-spill    no stack accesses and no pushes or pops
+    reg-return  no stores through the hidden return pointer in %rdi
+    size<=N     the function is at most N bytes long
+
+A property prefixed with '~' is a known failure: it is reported as XFAIL
+while it fails, and as an error (XPASS) once it holds, so that the
+expectation is updated.
+
+The source is compiled with -O2 -DNDEBUG. The checks apply only to x86-64
+with AT&T syntax; for other targets the harness reports that it skipped the
+checks and succeeds.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+CODEGEN_RE = re.compile(r'//\s*CODEGEN\s+(\w+):\s*(.*)')
+THROW_RE = re.compile(r'__cxa_throw|__cxa_allocate_exception|__throw_|bad_variant_access|bad_expected_access|bad_optional_access')
+STACK_RE = re.compile(r'\(%[re](sp|bp)[,)]')
+RDI_MEM_RE = re.compile(r'^[^(]*\(%rdi[,)]')
+NON_STORES = ('lea', 'cmp', 'test', 'prefetch', 'bt')
+
+
+def split_operands(s):
+    ops, depth, cur = [], 0, ''
+    for c in s:
+        if c == '(':
+            depth += 1
+        elif c == ')':
+            depth -= 1
+        if c == ',' and depth == 0:
+            ops.append(cur.strip())
+            cur = ''
+        else:
+            cur += c
+    if cur.strip():
+        ops.append(cur.strip())
+    return ops
+
+
+def parse_asm(text):
+    """Map function names (including .cold parts) to lists of (mnemonic, operands)."""
+    funcs = {}
+    cur = None
+    for line in text.splitlines():
+        line = line.split('#', 1)[0].rstrip()
+        if not line:
+            continue
+        m = re.match(r'^([A-Za-z_.$][\w.$]*):', line)
+        if m:
+            name = m.group(1)
+            if not name.startswith('.L'):
+                cur = funcs.setdefault(name, [])
+            continue
+        s = line.strip()
+        if s.startswith('.'):
+            if s.startswith('.size') and cur is not None:
+                cur = None
+            continue
+        if cur is None:
+            continue
+        parts = s.split(None, 1)
+        cur.append((parts[0], split_operands(parts[1]) if len(parts) > 1 else []))
+    return funcs
+
+
+def check_property(prop, insns, size):
+    """Return None if the property holds, or a description of the failure."""
+    if prop == 'no-call':
+        for mn, ops in insns:
+            if mn.startswith('call'):
+                return f'call {ops[0] if ops else ""}'
+            if mn.startswith('jmp') and ops and not ops[0].startswith('.L'):
+                return f'tail call {ops[0]}'
+        return None
+
+    if prop == 'no-throw':
+        for mn, ops in insns:
+            for op in ops:
+                if THROW_RE.search(op):
+                    return f'{mn} {op}'
+        return None
+
+    if prop == 'no-spill':
+        for mn, ops in insns:
+            if mn.startswith('push') or mn.startswith('pop'):
+                return f'{mn} {", ".join(ops)}'
+            for op in ops:
+                if STACK_RE.search(op):
+                    return f'{mn} {", ".join(ops)}'
+        return None
+
+    if prop == 'reg-return':
+        for mn, ops in insns:
+            if len(ops) >= 2 and not mn.startswith(NON_STORES) and RDI_MEM_RE.search(ops[-1]):
+                return f'{mn} {", ".join(ops)}'
+        return None
+
+    m = re.match(r'size<=(\d+)$', prop)
+    if m:
+        if size is None:
+            return 'no size for symbol'
+        if size > int(m.group(1)):
+            return f'size {size}'
+        return None
+
+    raise ValueError(f'unknown property {prop}')
+
+
+def symbol_sizes(cxx, flags, src, obj):
+    subprocess.run([cxx, *flags, '-c', '-o', obj, src], check=True)
+    out = subprocess.run(['nm', '-S', '--defined-only', obj], check=True, capture_output=True, text=True).stdout
+    sizes = {}
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 4:
+            sizes[fields[3]] = int(fields[1], 16)
+    return sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(description='check generated code against expectations')
+    parser.add_argument('--cxx', default=os.environ.get('CXX', 'c++'))
+    parser.add_argument('--std', default='c++17')
+    parser.add_argument('--flag', action='append', default=[], help='additional compiler flag')
+    parser.add_argument('sources', nargs='+')
+    args = parser.parse_args()
+
+    machine = subprocess.run([args.cxx, '-dumpmachine'], check=True, capture_output=True, text=True).stdout.strip()
+    if not machine.startswith('x86_64'):
+        print(f'codegen: skipping checks for target {machine}')
+        return 0
+
+    flags = [f'-std={args.std}', '-O2', '-DNDEBUG', '-fno-asynchronous-unwind-tables', *args.flag]
+    failures = 0
+
+    with tempfile.TemporaryDirectory() as tmp:
+        for src in args.sources:
+            with open(src) as f:
+                expectations = [m.groups() for m in map(CODEGEN_RE.search, f) if m]
+
+            asm = subprocess.run([args.cxx, *flags, '-S', '-o', '-', src], check=True, capture_output=True, text=True).stdout
+            funcs = parse_asm(asm)
+            sizes = symbol_sizes(args.cxx, flags, src, os.path.join(tmp, 'codegen.o'))
+
+            base = os.path.basename(src)
+            for fn, props in expectations:
+                if fn not in funcs:
+                    print(f'FAIL   {args.std} {base} {fn}: function not found')
+                    failures += 1
+                    continue
+
+                for prop in props.split():
+                    known = prop.startswith('~')
+                    prop = prop.lstrip('~')
+
+                    insns = funcs[fn]
+                    if prop == 'no-throw':
+                        insns = insns+funcs.get(fn+'.cold', [])
+                    failure = check_property(prop, insns, sizes.get(fn))
+
+                    if failure is None:
+                        status = 'XPASS' if known else 'PASS'
+                    else:
+                        status = 'XFAIL' if known else 'FAIL'
+                    if status in ('FAIL', 'XPASS'):
+                        failures += 1
+
+                    detail = f': {failure}' if failure else ''
+                    print(f'{status:<6} {args.std} {base} {fn} {prop}{detail}')
+
+    if failures:
+        print(f'codegen: {failures} unexpected result(s) for {args.std}', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,21 @@
+// Chains of and_then and transform on expected<int, int>.
+//
+// CODEGEN chain_and_then: reg-return no-spill no-call no-throw size<=48
+// CODEGEN chain_transform: reg-return no-spill no-call no-throw size<=48
+
+#include <backport/expected.h>
+
+using backport::expected;
+using backport::unexpected;
+
+extern "C" expected<int, int> chain_and_then(expected<int, int> x) {
+    return x.and_then([](int v) -> expected<int, int> { return v+1; })
+            .and_then([](int v) -> expected<int, int> { if (v<0) return unexpected(v); return 2*v; })
+            .and_then([](int v) -> expected<int, int> { return v-3; });
+}
+
+extern "C" expected<int, int> chain_transform(expected<int, int> x) {
+    return x.transform([](int v) { return v+1; })
+            .transform([](int v) { return 2*v; })
+            .transform([](int v) { return v-3; });
+}
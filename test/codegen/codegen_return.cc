@@ -0,0 +1,34 @@
+// Returning expected<int, int> by value.
+//
+// With trivially copyable contents, the union and flag are held as direct
+// members of expected, and the object is assembled in %rax as for a plain
+// struct; the layered storage used otherwise is assembled on the stack.
+//
+// CODEGEN make_value: reg-return no-spill no-call size<=16
+// CODEGEN make_error: reg-return no-spill no-call size<=16
+// CODEGEN pass_error: reg-return no-spill no-call size<=48
+
+#include <type_traits>
+
+#include <backport/expected.h>
+
+using backport::expected;
+using backport::unexpected;
+
+// expected<int, int> must be returned in registers under the x86-64 SysV ABI
+static_assert(sizeof(expected<int, int>)<=16);
+static_assert(std::is_trivially_copyable_v<expected<int, int>>);
+
+extern "C" expected<int, int> make_value(int x) {
+    return x;
+}
+
+extern "C" expected<int, int> make_error(int e) {
+    return unexpected(e);
+}
+
+// forward an error, replace a value
+extern "C" expected<int, int> pass_error(expected<int, int> x) {
+    if (!x) return unexpected(x.error());
+    return *x+1;
+}
@@ -0,0 +1,27 @@
+// Access to the value of expected<int, int>.
+//
+// CODEGEN get_value_or: no-spill no-call no-throw size<=48
+// CODEGEN get_deref: no-spill no-call no-throw size<=16
+// CODEGEN get_has_value: no-spill no-call no-throw size<=16
+// CODEGEN get_value: no-spill size<=32
+
+#include <backport/expected.h>
+
+using backport::expected;
+
+extern "C" int get_value_or(expected<int, int> x) {
+    return x.value_or(7);
+}
+
+extern "C" int get_deref(expected<int, int> x) {
+    return *x;
+}
+
+extern "C" bool get_has_value(expected<int, int> x) {
+    return x.has_value();
+}
+
+// the throw of bad_expected_access is outlined to get_value.cold
+extern "C" int get_value(expected<int, int> x) {
+    return x.value();
+}
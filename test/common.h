@@ -22,7 +22,7 @@ struct counted {
         ++n_copy_ctor;
     }
 
-    counted(counted&& other): inner(std::move(other.inner)) {
+    counted(counted&& other) noexcept(std::is_nothrow_move_constructible_v<X>): inner(std::move(other.inner)) {
         ++n_move_ctor;
         other.is_moved = true;
     }
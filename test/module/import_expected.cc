@@ -0,0 +1,58 @@
+// Importer of the backport.expected module, built and run by the test-module
+// target; returns non-zero on failure.
+
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+import backport.expected;
+
+namespace {
+
+struct alignas(8) node { int v; };
+
+backport::expected<int, std::errc> parse_digit(char c) {
+    if (c>='0' && c<='9') return c-'0';
+    return backport::unexpected(std::errc::invalid_argument);
+}
+
+} // anonymous namespace
+
+// niche_traits is exported as a customization point
+template <>
+struct backport::niche_traits<node*>: backport::aligned_pointer_niche_traits<node> {};
+
+int main() {
+    int failures = 0;
+    auto check = [&](bool ok) { failures += !ok; };
+
+    using backport::expected;
+    using backport::unexpect;
+    using backport::unexpected;
+
+    auto d = parse_digit('7').transform([](int n) { return n*2; });
+    check(d && *d==14);
+    check(parse_digit('x').error()==std::errc::invalid_argument);
+    check(parse_digit('x').value_or(-1)==-1);
+
+    expected<int, int> e(3), u(unexpect, 4);
+    check(e!=u && u==unexpected(4));
+
+    // specializations declared in the header are reachable
+    check(sizeof(expected<int*, std::errc>)==sizeof(int*));
+    check(sizeof(expected<node*, std::errc>)==sizeof(node*));
+    check(backport::is_trivially_relocatable_v<expected<int, backport::boxed<std::vector<int>>>>);
+
+    expected<int, backport::boxed<std::vector<int>>> b(unexpect, std::vector<int>{1, 2});
+    check(b.error().size()==2u);
+
+    try {
+        (void)u.value();
+        check(false);
+    }
+    catch (backport::bad_expected_access<int>& ex) {
+        check(ex.error()==4);
+    }
+
+    return failures;
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <execution>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a small grain, so that the ranges below are evaluated by several threads
+// where there are several cores
+#define BACKPORT_EXPECTED_COLLECT_GRAIN 1000
+
+#include <backport/collect.h>
+
+using backport::collect;
+using backport::expected;
+using backport::unexpect;
+using backport::unexpected;
+
+TEST(collect, sequential) {
+    using ex = expected<int, std::string>;
+
+    std::vector<ex> xs{1, 2, 3};
+    auto r = collect(xs.begin(), xs.end());
+    static_assert(std::is_same_v<expected<std::vector<int>, std::string>, decltype(r)>);
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), r);
+
+    xs.push_back(unexpected("first"));
+    xs.push_back(4);
+    xs.push_back(unexpected("second"));
+    EXPECT_EQ(unexpected("first"), collect(xs.begin(), xs.end()));
+
+    std::list<int> ns{4, 9, -1, 16, -2};
+    int n_call = 0;
+    auto f = [&](int n) -> expected<double, int> {
+        ++n_call;
+        if (n<0) return unexpected(n);
+        return n*0.5;
+    };
+
+    EXPECT_EQ(unexpected(-1), collect(ns.begin(), ns.end(), f));
+    EXPECT_EQ(3, n_call);
+
+    n_call = 0;
+    EXPECT_EQ(unexpected(-1), collect(std::execution::seq, ns.begin(), ns.end(), f));
+    EXPECT_EQ(3, n_call);
+
+    // move-only values
+    std::vector<expected<std::unique_ptr<int>, int>> ps;
+    ps.emplace_back(std::make_unique<int>(5));
+    ps.emplace_back(std::make_unique<int>(6));
+    auto q = collect(std::make_move_iterator(ps.begin()), std::make_move_iterator(ps.end()));
+    ASSERT_TRUE(q);
+    EXPECT_EQ(6, *q->at(1));
+}
+
+TEST(collect, parallel) {
+    constexpr int n = 100000;
+    std::vector<int> ns(n);
+    for (int i = 0; i<n; ++i) ns[i] = i;
+
+    auto f = [](int i) -> expected<long, int> { return 2L*i; };
+    auto r = collect(std::execution::par, ns.begin(), ns.end(), f);
+    ASSERT_TRUE(r);
+    ASSERT_EQ(std::size_t(n), r->size());
+    for (int i = 0; i<n; ++i) ASSERT_EQ(2L*i, (*r)[i]);
+
+    // the reported error is that of the lowest-indexed failing element
+    std::atomic<int> n_call{0};
+    auto g = [&](int i) -> expected<long, int> {
+        ++n_call;
+        if (i%9000==8999) return unexpected(i);
+        return i;
+    };
+    for (int k = 0; k<10; ++k) {
+        n_call = 0;
+        EXPECT_EQ(unexpected(8999), collect(std::execution::par_unseq, ns.begin(), ns.end(), g));
+        EXPECT_LE(8999+1, n_call.load());
+        EXPECT_LE(n_call.load(), n);
+    }
+
+    std::vector<expected<int, int>> xs(n, 1);
+    xs[70000] = unexpected(7);
+    xs[30000] = unexpected(3);
+    EXPECT_EQ(unexpected(3), collect(std::execution::par, xs.begin(), xs.end()));
+
+    // bool values are written concurrently to distinct bytes, not to the
+    // shared words of a std::vector<bool>
+    constexpr int n_bool = 40001;
+    auto is_odd = [](int i) -> expected<bool, int> { return i%2==1; };
+    for (int k = 0; k<10; ++k) {
+        auto b = collect(std::execution::par, ns.begin(), ns.begin()+n_bool, is_odd);
+        static_assert(std::is_same_v<expected<std::vector<bool>, int>, decltype(b)>);
+        ASSERT_TRUE(b);
+        ASSERT_EQ(std::size_t(n_bool), b->size());
+        for (int i = 0; i<n_bool; ++i) ASSERT_EQ(i%2==1, bool((*b)[i])) << i;
+    }
+}
+
+TEST(collect, parallel_threshold) {
+    std::vector<int> ns(100000);
+
+    // below twice the grain, only the calling thread evaluates elements
+    std::atomic<int> n_other{0};
+    const auto self = std::this_thread::get_id();
+    auto f = [&](int i) -> expected<int, int> {
+        if (std::this_thread::get_id()!=self) ++n_other;
+        return i;
+    };
+
+    EXPECT_TRUE(collect(std::execution::par, ns.begin(), ns.begin()+1999, f));
+    EXPECT_EQ(0, n_other.load());
+
+    // with the default grain, likewise for a range of 65535 cheap elements,
+    // too few to repay starting a thread
+    EXPECT_TRUE(backport::detail::collect_parallel(ns.begin(), ns.begin()+65535, f, 32768));
+    EXPECT_EQ(0, n_other.load());
+
+    // whereas a grain of one element uses every core
+    EXPECT_TRUE(backport::detail::collect_parallel(ns.begin(), ns.end(), f, 1));
+    EXPECT_TRUE(backport::detail::collect_parallel(ns.begin(), ns.end(), f, 0));
+}
+
+TEST(collect, exceptions) {
+    constexpr int n = 100000;
+    std::vector<int> ns(n);
+    for (int i = 0; i<n; ++i) ns[i] = i;
+
+    auto f = [](int i) -> expected<int, int> {
+        if (i==50000) throw std::runtime_error("boom");
+        if (i==60000) return unexpected(i);
+        return i;
+    };
+    EXPECT_THROW(collect(std::execution::par, ns.begin(), ns.end(), f), std::runtime_error);
+
+    auto g = [](int i) -> expected<int, int> {
+        if (i==60000) throw std::runtime_error("boom");
+        if (i==50000) return unexpected(i);
+        return i;
+    };
+    EXPECT_EQ(unexpected(50000), collect(std::execution::par, ns.begin(), ns.end(), g));
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
 #include <utility>
 #include <vector>
 
@@ -375,6 +379,37 @@ TEST(expected, ctors) {
         EXPECT_EQ(0, cy::n_copy_assign);
         EXPECT_EQ(0, cy::n_move_assign);
     }
+
+    {
+        // move-only errors: implicit construction from an unexpected rvalue
+        using ex = expected<int, std::unique_ptr<int>>;
+        using vex = expected<void, std::unique_ptr<int>>;
+
+        ex x = unexpected(std::make_unique<int>(3));
+        ASSERT_FALSE(x);
+        EXPECT_EQ(3, *x.error());
+
+        vex v = unexpected(std::make_unique<int>(4));
+        ASSERT_FALSE(v);
+        EXPECT_EQ(4, *v.error());
+
+        EXPECT_TRUE((std::is_convertible_v<unexpected<std::unique_ptr<int>>, ex>));
+        EXPECT_FALSE((std::is_constructible_v<ex, const unexpected<std::unique_ptr<int>>&>));
+    }
+
+    {
+        // neither value nor error default constructible
+
+        struct nd {
+            explicit nd(int n): n(n) {}
+            int n;
+        };
+
+        expected<nd, nd> x(std::in_place, 1), y(unexpect, 2);
+        EXPECT_FALSE((std::is_default_constructible_v<expected<nd, nd>>));
+        EXPECT_EQ(1, x->n);
+        EXPECT_EQ(2, y.error().n);
+    }
 }
 
 TEST(expected, assignment) {
@@ -403,6 +438,7 @@ TEST(expected, assignment) {
         EXPECT_TRUE(ae1.has_value());
         EXPECT_EQ(1, cx::n_copy_assign);
 
+        // a copy that switches state is made aside and moved into place
         ae2 = bu;
         EXPECT_FALSE(ae2.has_value());
         EXPECT_EQ(1, cy::n_copy_ctor);
@@ -413,7 +449,7 @@ TEST(expected, assignment) {
 
         ae4 = expected<cx, cy>(unexpect);
         EXPECT_FALSE(ae4.has_value());
-        EXPECT_EQ(1, cy::n_move_ctor);
+        EXPECT_EQ(2, cy::n_move_ctor);
 
         au1 = be;
         EXPECT_TRUE(au1.has_value());
@@ -425,7 +461,7 @@ TEST(expected, assignment) {
 
         au3 = expected<cx, cy>{};
         EXPECT_TRUE(au3.has_value());
-        EXPECT_EQ(1, cx::n_move_ctor);
+        EXPECT_EQ(2, cx::n_move_ctor);
 
         au4 = expected<cx, cy>(unexpect);
         EXPECT_FALSE(au4.has_value());
@@ -434,12 +470,12 @@ TEST(expected, assignment) {
         // check total ctors, assigns
 
         EXPECT_EQ(1, cx::n_copy_ctor);
-        EXPECT_EQ(1, cx::n_move_ctor);
+        EXPECT_EQ(2, cx::n_move_ctor);
         EXPECT_EQ(1, cx::n_copy_assign);
         EXPECT_EQ(1, cx::n_move_assign);
 
         EXPECT_EQ(1, cy::n_copy_ctor);
-        EXPECT_EQ(1, cy::n_move_ctor);
+        EXPECT_EQ(2, cy::n_move_ctor);
         EXPECT_EQ(1, cy::n_copy_assign);
         EXPECT_EQ(1, cy::n_move_assign);
 
@@ -511,16 +547,17 @@ TEST(expected, assignment) {
         EXPECT_TRUE(ae2.has_value());
         EXPECT_EQ(1, cx::n_move_assign);
 
+        // copied aside and moved into place
         au1 = x;
         EXPECT_TRUE(au1.has_value());
         EXPECT_EQ(1, cx::n_copy_ctor);
 
         au2 = cx{};
         EXPECT_TRUE(au2.has_value());
-        EXPECT_EQ(1, cx::n_move_ctor);
+        EXPECT_EQ(2, cx::n_move_ctor);
 
         EXPECT_EQ(1, cx::n_copy_ctor);
-        EXPECT_EQ(1, cx::n_move_ctor);
+        EXPECT_EQ(2, cx::n_move_ctor);
         EXPECT_EQ(1, cx::n_copy_assign);
         EXPECT_EQ(1, cx::n_move_assign);
 
@@ -531,6 +568,7 @@ TEST(expected, assignment) {
         cx::reset();
         cy::reset();
 
+        // copied aside and moved into place
         unexpected<cy> y(in_place);
         be1 = y;
         EXPECT_FALSE(be1.has_value());
@@ -539,7 +577,7 @@ TEST(expected, assignment) {
 
         be2 = unexpected(cy{});
         EXPECT_FALSE(be2.has_value());
-        EXPECT_EQ(2, cy::n_move_ctor);
+        EXPECT_EQ(3, cy::n_move_ctor);
         EXPECT_EQ(0, cy::n_move_assign);
 
         bu1 = y;
@@ -653,6 +691,82 @@ TEST(expected, assignment) {
     }
 }
 
+namespace {
+// Construction from a negative int throws; moves may throw unless Nothrow.
+template <bool Nothrow>
+struct fragile {
+    int n;
+    explicit fragile(int n): n(n) { if (n<0) throw n; }
+    fragile(fragile&& other) noexcept(Nothrow): n(other.n) {}
+    fragile& operator=(int m) { n = m; return *this; }
+};
+}
+
+TEST(expected, assignment_strong) {
+    // switching state with a nothrow construction: no moves
+    using cx = counted<int>;
+    expected<cx, cx> e(unexpect, 1);
+    cx::reset();
+    for (int i = 0; i<3; ++i) {
+        e = i;
+        ASSERT_TRUE(e.has_value());
+        e = unexpected(i);
+        ASSERT_FALSE(e.has_value());
+    }
+    EXPECT_EQ(0, cx::n_move_ctor);
+    EXPECT_EQ(0, cx::n_copy_ctor);
+
+    // the new value is constructed aside and moved into place
+    expected<fragile<true>, int> a(unexpect, 2);
+    EXPECT_THROW(a = -1, int);
+    ASSERT_FALSE(a.has_value());
+    EXPECT_EQ(2, a.error());
+    a = 3;
+    EXPECT_EQ(3, a->n);
+
+    expected<int, fragile<true>> b(4);
+    EXPECT_THROW(b = unexpected(-1), int);
+    ASSERT_TRUE(b.has_value());
+    EXPECT_EQ(4, *b);
+
+    // the old member is moved aside and restored
+    expected<fragile<false>, std::string> c(unexpect, "error");
+    EXPECT_THROW(c = -1, int);
+    ASSERT_FALSE(c.has_value());
+    EXPECT_EQ("error", c.error());
+    c = 5;
+    EXPECT_EQ(5, c->n);
+
+    expected<std::string, fragile<false>> d("value");
+    EXPECT_THROW(d = unexpected(-1), int);
+    ASSERT_TRUE(d.has_value());
+    EXPECT_EQ("value", *d);
+
+    // if neither move is nothrow, an assignment that could switch state with
+    // a throwing construction is not available
+    using ff = expected<fragile<false>, fragile<false>>;
+    EXPECT_FALSE(std::is_move_assignable_v<ff>);
+    EXPECT_FALSE((std::is_assignable_v<ff&, int>));
+    EXPECT_FALSE((std::is_assignable_v<ff&, unexpected<int>>));
+
+    // unless the new value or error is constructed without throwing
+    struct copy_only {
+        int n;
+        copy_only(int n) noexcept: n(n) {}
+        copy_only(const copy_only& other): n(other.n) {}
+        copy_only& operator=(const copy_only&) = default;
+    };
+    using cc = expected<copy_only, copy_only>;
+    EXPECT_FALSE(std::is_copy_assignable_v<cc>);
+    EXPECT_TRUE((std::is_assignable_v<cc&, int>));
+    EXPECT_TRUE((std::is_assignable_v<cc&, unexpected<int>>));
+    cc f(unexpect, 1);
+    f = 2;
+    EXPECT_EQ(2, f->n);
+    f = unexpected(3);
+    EXPECT_EQ(3, f.error().n);
+}
+
 TEST(expected, emplace) {
     using cc = counted<check_in_place>;
     struct empty {};
@@ -915,8 +1029,421 @@ TEST(expected, access) {
 }
 
 
+TEST(expected, trivial) {
+    using eii = expected<int, int>;
+    EXPECT_TRUE(std::is_trivially_copyable_v<eii>);
+    EXPECT_TRUE(std::is_trivially_destructible_v<eii>);
+    EXPECT_TRUE(std::is_trivially_copy_constructible_v<eii>);
+    EXPECT_TRUE(std::is_trivially_move_constructible_v<eii>);
+    EXPECT_TRUE(std::is_trivially_copy_assignable_v<eii>);
+    EXPECT_TRUE(std::is_trivially_move_assignable_v<eii>);
+    EXPECT_EQ(2*sizeof(int), sizeof(eii));
+
+    using ci = counted<int>;
+    EXPECT_FALSE((std::is_trivially_copyable_v<expected<ci, int>>));
+    EXPECT_FALSE((std::is_trivially_copyable_v<expected<int, ci>>));
+    EXPECT_TRUE((std::is_trivially_destructible_v<expected<ci, int>>));
+    EXPECT_FALSE((std::is_trivially_destructible_v<expected<std::vector<int>, int>>));
+
+    struct move_only {
+        move_only() = default;
+        move_only(move_only&&) = default;
+        move_only& operator=(move_only&&) = default;
+    };
+
+    EXPECT_FALSE((std::is_copy_constructible_v<expected<move_only, int>>));
+    EXPECT_FALSE((std::is_copy_assignable_v<expected<move_only, int>>));
+    EXPECT_TRUE((std::is_move_constructible_v<expected<move_only, int>>));
+    EXPECT_TRUE((std::is_move_assignable_v<expected<move_only, int>>));
+
+    EXPECT_FALSE((std::is_copy_constructible_v<expected<std::unique_ptr<int>, int>>));
+    EXPECT_TRUE((std::is_nothrow_move_constructible_v<expected<std::unique_ptr<int>, int>>));
+}
+
+namespace {
+struct alignas(8) node;
+enum class small_err: unsigned char { a = 1, b, c };
+
+// an opaque handle type, declared but never defined
+struct opaque;
 
-#if 0
+// A handle whose generation is never all-ones; the id bytes are free to
+// carry an error payload.
+struct handle {
+    std::uint32_t id;
+    std::uint32_t gen;
+};
+}
+
+// the pointer niche is opt-in for class types
+template <>
+struct backport::niche_traits<node*>: backport::aligned_pointer_niche_traits<node> {};
+
+namespace {
+struct alignas(8) node { int v; };
+}
+
+template <>
+struct backport::niche_traits<handle> {
+    static constexpr bool has_niche = true;
+    static constexpr std::size_t payload_offset = 0;
+    static constexpr std::size_t payload_size = sizeof(std::uint32_t);
+
+    static constexpr handle niche() noexcept { return {0, ~std::uint32_t(0)}; }
+    static constexpr bool is_niche(const handle& h) noexcept { return h.gen==~std::uint32_t(0); }
+};
+
+// A node holding an expected of a pointer to its own type, with the niche
+// declared before the node is complete.
+namespace {
+struct list_node;
+}
+
+template <>
+struct backport::niche_traits<list_node*>: backport::aligned_pointer_niche_traits<list_node> {};
+
+namespace {
+struct alignas(8) list_node {
+    int v;
+    expected<list_node*, small_err> next;
+};
+
+// declared with a forward-declared pointee: no niche, whether or not the
+// pointee is complete where expected is instantiated
+struct fwd_node;
+using efwd = expected<fwd_node*, small_err>;
+efwd first_of(efwd e);
+struct alignas(8) fwd_node { int v; };
+efwd first_of(efwd e) { return e; }
+}
+
+TEST(expected, niche) {
+    using enp = expected<node*, small_err>;
+    EXPECT_EQ(sizeof(node*), sizeof(enp));
+    EXPECT_EQ(sizeof(node*), (sizeof(expected<node*, int>)));
+    EXPECT_TRUE(std::is_trivially_copyable_v<enp>);
+
+    // forward-declared pointees
+    EXPECT_LT(sizeof(fwd_node*), sizeof(efwd));
+    fwd_node f{5};
+    EXPECT_EQ(5, (*first_of(&f))->v);
+
+    // pointers to scalars have a niche without opting in
+    EXPECT_EQ(sizeof(int*), (sizeof(expected<int*, small_err>)));
+    EXPECT_EQ(sizeof(double**), (sizeof(expected<double**, small_err>)));
+
+    // pointers to a type that is never defined
+    {
+        opaque* p = reinterpret_cast<opaque*>(&f);
+        expected<opaque*, small_err> o(p), ou(unexpect, small_err::a);
+        EXPECT_LT(sizeof(opaque*), sizeof(o));
+        EXPECT_EQ(p, *o);
+        EXPECT_EQ(small_err::a, ou.error());
+
+        expected<void, opaque*> v, vu(unexpect, p);
+        EXPECT_TRUE(v.has_value());
+        EXPECT_EQ(p, vu.error());
+
+        expected<opaque&, small_err> r(*p);
+        EXPECT_EQ(p, &*r);
+    }
+
+    EXPECT_EQ(sizeof(list_node*), (sizeof(expected<list_node*, small_err>)));
+    list_node tail{2, unexpected(small_err::c)}, head{1, &tail};
+    ASSERT_TRUE(head.next.has_value());
+    EXPECT_EQ(2, (*head.next)->v);
+    ASSERT_FALSE(tail.next.has_value());
+    EXPECT_EQ(small_err::c, tail.next.error());
+
+    // no niche available: char has alignment 1
+    EXPECT_LT(sizeof(char*), (sizeof(expected<char*, small_err>)));
+
+    node n{3};
+    enp e1(&n), e2(nullptr), u1(unexpect, small_err::b);
+
+    ASSERT_TRUE(e1.has_value());
+    EXPECT_EQ(&n, *e1);
+    EXPECT_EQ(3, e1.value()->v);
+
+    ASSERT_TRUE(e2.has_value());
+    EXPECT_EQ(nullptr, *e2);
+
+    ASSERT_FALSE(u1.has_value());
+    EXPECT_EQ(small_err::b, u1.error());
+
+    enp u2(u1);
+    ASSERT_FALSE(u2.has_value());
+    EXPECT_EQ(small_err::b, u2.error());
+    EXPECT_EQ(u1, u2);
+
+    e2 = unexpected(small_err::c);
+    ASSERT_FALSE(e2.has_value());
+    EXPECT_EQ(small_err::c, e2.error());
+
+    e2.error() = small_err::a;
+    EXPECT_EQ(small_err::a, e2.error());
+
+    e2 = &n;
+    ASSERT_TRUE(e2.has_value());
+    EXPECT_EQ(e1, e2);
+
+    using std::swap;
+    swap(e1, u1);
+    ASSERT_FALSE(e1.has_value());
+    EXPECT_EQ(small_err::b, e1.error());
+    ASSERT_TRUE(u1.has_value());
+    EXPECT_EQ(&n, *u1);
+
+    expected<node*, int> ei(unexpect, -7);
+    ASSERT_FALSE(ei.has_value());
+    EXPECT_EQ(-7, ei.error());
+    EXPECT_EQ(&n, ei.value_or(&n));
+
+    // user-declared niche
+    using eh = expected<handle, std::uint16_t>;
+    EXPECT_EQ(sizeof(handle), sizeof(eh));
+
+    eh h1(handle{4, 5}), h2(unexpect, 0xffffu);
+    ASSERT_TRUE(h1.has_value());
+    EXPECT_EQ(4u, h1->id);
+    EXPECT_EQ(5u, h1->gen);
+    ASSERT_FALSE(h2.has_value());
+    EXPECT_EQ(0xffffu, h2.error());
+
+    h1 = h2;
+    ASSERT_FALSE(h1.has_value());
+    EXPECT_EQ(0xffffu, h1.error());
+}
+
+namespace {
+enum class status { ok, busy, failed };
+}
+
+template <>
+struct backport::niche_traits<status>: backport::niche_value_traits<status, status::ok> {};
+
+TEST(expected, packed_void) {
+    using ev = expected<void, std::errc>;
+    EXPECT_EQ(sizeof(std::errc), sizeof(ev));
+    EXPECT_TRUE(std::is_trivially_copyable_v<ev>);
+
+    ev e, u(unexpect, std::errc::invalid_argument);
+    EXPECT_TRUE(e.has_value());
+    ASSERT_FALSE(u.has_value());
+    EXPECT_EQ(std::errc::invalid_argument, u.error());
+    EXPECT_NE(e, u);
+
+    e = unexpected(std::errc::io_error);
+    ASSERT_FALSE(e.has_value());
+    EXPECT_EQ(std::errc::io_error, e.error());
+    EXPECT_EQ(unexpected(std::errc::io_error), e);
+
+    using std::swap;
+    swap(e, u);
+    EXPECT_EQ(std::errc::invalid_argument, e.error());
+    EXPECT_EQ(std::errc::io_error, u.error());
+
+    e.emplace();
+    EXPECT_TRUE(e.has_value());
+    EXPECT_NO_THROW(e.value());
+    EXPECT_THROW(u.value(), bad_expected_access<std::errc>);
+
+    EXPECT_EQ(std::errc::io_error, u.error_or(std::errc::timed_out));
+    EXPECT_EQ(std::errc::timed_out, e.error_or(std::errc::timed_out));
+
+    // user-declared ok value
+
+    using es = expected<void, status>;
+    EXPECT_EQ(sizeof(status), sizeof(es));
+
+    es s1, s2(unexpect, status::busy);
+    EXPECT_TRUE(s1.has_value());
+    EXPECT_FALSE(s2.has_value());
+    EXPECT_EQ(status::busy, s2.error());
+
+    es s3(s2);
+    EXPECT_EQ(s2, s3);
+    s3 = unexpected(status::failed);
+    EXPECT_EQ(status::failed, s3.error());
+
+    // conversion between packed and unpacked error storage
+
+    expected<void, int> vi(s2.transform_error([](status s) { return static_cast<int>(s); }));
+    EXPECT_EQ(unexpected(1), vi);
+    EXPECT_LT(sizeof(int), sizeof(vi));
+}
+
+TEST(expected, boxed) {
+    using backport::boxed;
+
+    struct diagnostic {
+        int code = 0;
+        char text[200] = {};
+    };
+
+    using eb = expected<int, boxed<diagnostic>>;
+    EXPECT_TRUE((std::is_same_v<diagnostic, eb::error_type>));
+    EXPECT_TRUE((std::is_same_v<unexpected<diagnostic>, eb::unexpected_type>));
+    EXPECT_LE(sizeof(eb), 2*sizeof(void*));
+    EXPECT_TRUE(std::is_nothrow_move_assignable_v<boxed<diagnostic>>);
+
+    eb e1(3), u1(unexpected(diagnostic{7}));
+    ASSERT_TRUE(e1.has_value());
+    EXPECT_EQ(3, *e1);
+    ASSERT_FALSE(u1.has_value());
+    EXPECT_EQ(7, u1.error().code);
+    EXPECT_TRUE((std::is_same_v<diagnostic&, decltype(u1.error())>));
+    EXPECT_THROW(u1.value(), bad_expected_access<diagnostic>);
+
+    eb u2(u1);
+    ASSERT_FALSE(u2.has_value());
+    EXPECT_EQ(7, u2.error().code);
+    EXPECT_NE(&u1.error(), &u2.error());
+
+    eb u3(std::move(u2));
+    ASSERT_FALSE(u3.has_value());
+    EXPECT_EQ(7, u3.error().code);
+
+    e1 = unexpected(diagnostic{8});
+    ASSERT_FALSE(e1.has_value());
+    EXPECT_EQ(8, e1.error().code);
+
+    e1 = u3;
+    EXPECT_EQ(7, e1.error().code);
+
+    e1 = 4;
+    ASSERT_TRUE(e1.has_value());
+    EXPECT_EQ(4, *e1);
+
+    auto t = u1.transform([](int x) { return x+1.5; });
+    EXPECT_TRUE((std::is_same_v<expected<double, boxed<diagnostic>>, decltype(t)>));
+    ASSERT_FALSE(t.has_value());
+    EXPECT_EQ(7, t.error().code);
+
+    auto c = u1.transform_error([](const diagnostic& d) { return d.code; });
+    EXPECT_TRUE((std::is_same_v<expected<int, int>, decltype(c)>));
+    EXPECT_EQ(unexpected(7), c);
+
+    expected<void, boxed<diagnostic>> vb(unexpect, diagnostic{9});
+    ASSERT_FALSE(vb.has_value());
+    EXPECT_EQ(9, vb.error().code);
+
+    // moves of values do not touch the error; move assignment of errors
+    // exchanges the allocations
+
+    using cx = counted<int>;
+    cx::reset();
+    expected<int, boxed<cx>> v1(3);
+    expected<int, boxed<cx>> v2(std::move(v1));
+    EXPECT_EQ(3, *v2);
+    expected<int, boxed<cx>> v3(unexpect, 5), v4(unexpect, 6);
+    const cx* p = &v3.error();
+    v4 = std::move(v3);
+    ASSERT_FALSE(v4.has_value());
+    EXPECT_EQ(p, &v4.error());
+    EXPECT_EQ(5, v4.error().inner);
+    EXPECT_EQ(0, cx::n_move_ctor);
+    EXPECT_EQ(0, cx::n_copy_ctor);
+    EXPECT_EQ(0, cx::n_move_assign);
+    ASSERT_FALSE(v3.has_value());
+    EXPECT_EQ(6, v3.error().inner);
+
+    // a moved-from expected holds a moved-from error, usable through the
+    // whole interface
+
+    using es = expected<int, boxed<std::string>>;
+    es s1(unexpect, "a long message, too long for the small string buffer");
+    es s2(std::move(s1));
+    EXPECT_EQ("a long message, too long for the small string buffer", s2.error());
+    ASSERT_FALSE(s1.has_value());
+    EXPECT_EQ(unexpected(std::string{}), s1);
+    EXPECT_NE(s1, s2);
+    EXPECT_EQ(s1, es(s1));
+    EXPECT_EQ(std::string{}, s1.error_or("x"));
+    EXPECT_THROW(s1.value(), bad_expected_access<std::string>);
+    EXPECT_EQ(unexpected(std::string{}), s1.transform([](int n) { return n; }));
+    s1 = unexpected(std::string("b"));
+    EXPECT_EQ("b", s1.error());
+
+    expected<void, boxed<diagnostic>> vc(std::move(vb));
+    ASSERT_FALSE(vb.has_value());
+    EXPECT_EQ(9, vb.error().code);
+    EXPECT_EQ(9, vc.error().code);
+    vb = unexpected(diagnostic{10});
+    EXPECT_EQ(10, vb.error().code);
+}
+
+TEST(expected, reference) {
+    using cx = counted<std::vector<int>>;
+    using er = expected<cx&, small_err>;
+    using ecr = expected<const cx&, small_err>;
+
+    EXPECT_LT(sizeof(cx*), sizeof(er));
+    EXPECT_EQ(sizeof(node*), (sizeof(expected<node&, small_err>)));
+    EXPECT_TRUE(std::is_trivially_copyable_v<er>);
+
+    // no binding to temporaries
+    EXPECT_TRUE((std::is_constructible_v<er, cx&>));
+    EXPECT_FALSE((std::is_constructible_v<er, cx&&>));
+    EXPECT_TRUE((std::is_constructible_v<ecr, const cx&>));
+    EXPECT_FALSE((std::is_constructible_v<ecr, cx&&>));
+    EXPECT_FALSE((std::is_constructible_v<ecr, expected<cx, small_err>&&>));
+    EXPECT_FALSE(std::is_default_constructible_v<er>);
+
+    cx::reset();
+    cx a(std::vector<int>{1, 2, 3}), b(std::vector<int>{4});
+
+    er e(a), u(unexpect, small_err::c);
+    ASSERT_TRUE(e.has_value());
+    EXPECT_EQ(&a, &*e);
+    EXPECT_EQ(&a, &e.value());
+    EXPECT_EQ(&a, &*std::move(e));
+    EXPECT_EQ(&a, &std::move(e).value());
+    EXPECT_EQ(3u, e->inner.size());
+    EXPECT_TRUE((std::is_same_v<cx&, decltype(*std::move(e))>));
+    EXPECT_TRUE((std::is_same_v<cx&, decltype(*std::as_const(e))>));
+
+    ASSERT_FALSE(u.has_value());
+    EXPECT_EQ(small_err::c, u.error());
+
+    // assignment of a value rebinds
+    e = b;
+    EXPECT_EQ(&b, &*e);
+    EXPECT_EQ(3u, a.inner.size());
+
+    u = a;
+    ASSERT_TRUE(u.has_value());
+    EXPECT_EQ(&a, &*u);
+
+    ecr c(e);
+    EXPECT_EQ(&b, &*c);
+
+    // monadic operations pass the reference through
+    auto t = std::move(e).transform([](cx& x) -> std::vector<int>& { return x.inner; });
+    EXPECT_TRUE((std::is_same_v<expected<std::vector<int>&, small_err>, decltype(t)>));
+    EXPECT_EQ(&b.inner, &*t);
+
+    const cx* seen = nullptr;
+    auto r = std::move(u).and_then([&seen](cx& x) { seen = &x; return expected<int, small_err>(x.inner.front()); });
+    EXPECT_EQ(&a, seen);
+    EXPECT_EQ(1, r);
+
+    EXPECT_EQ(0, cx::n_copy_ctor);
+    EXPECT_EQ(0, cx::n_move_ctor);
+    EXPECT_EQ(0, cx::n_copy_assign);
+    EXPECT_EQ(0, cx::n_move_assign);
+
+    // value_or copies
+    cx alt(std::vector<int>{});
+    EXPECT_EQ(1u, er(b).value_or(alt).inner.size());
+    EXPECT_EQ(1, cx::n_copy_ctor);
+
+    // no niche available for alignment-one referents
+    char ch = 'x';
+    expected<char&, small_err> ec(ch);
+    EXPECT_EQ(&ch, &*ec);
+    EXPECT_LT(sizeof(char*), sizeof(ec));
+}
 
 namespace {
 struct Xswap {
@@ -930,14 +1457,118 @@ struct Xswap {
     friend void swap(Xswap& x1, Xswap& x2) noexcept { x1.swap(x2); }
 };
 
+// As Xswap, but not trivially copyable, so that expected swaps it with swap()
+struct Xswap_nontrivial: Xswap {
+    using Xswap::Xswap;
+    Xswap_nontrivial(Xswap_nontrivial&&) = default;
+    ~Xswap_nontrivial() {}
+};
+
 struct swap_can_throw {
-    friend void swap(swap_can_throw& s1, swap_can_throw& s2) noexcept(false) {}
+    friend void swap(swap_can_throw&, swap_can_throw&) noexcept(false) {}
 };
 }
 
+TEST(expected, monadic_in_place) {
+    using cx = counted<int>;
+    using cy = counted<long>;
+
+    // the result of the callable is constructed directly in the result
+    expected<cx, int> e(in_place, 3);
+    cx::reset();
+    cy::reset();
+    auto t = std::move(e).transform([](cx&& x) { return cy(x.inner*2L); });
+    EXPECT_TRUE((std::is_same_v<expected<cy, int>, decltype(t)>));
+    EXPECT_EQ(6L, t->inner);
+    EXPECT_EQ(0, cy::n_move_ctor);
+    EXPECT_EQ(0, cy::n_copy_ctor);
+    EXPECT_EQ(0, cx::n_move_ctor);
+    EXPECT_EQ(0, cx::n_copy_ctor);
+
+    expected<int, cx> u(unexpect, 4);
+    cx::reset();
+    cy::reset();
+    auto te = std::move(u).transform_error([](cx&& x) { return cy(x.inner+1L); });
+    EXPECT_EQ(5L, te.error().inner);
+    EXPECT_EQ(0, cy::n_move_ctor);
+    EXPECT_EQ(0, cy::n_copy_ctor);
+
+    auto o = std::move(u).or_else([](cx&& x) { return expected<cy, int>(in_place, x.inner+2L); });
+    EXPECT_EQ(6L, o->inner);
+    EXPECT_EQ(0, cy::n_move_ctor);
+    EXPECT_EQ(0, cy::n_copy_ctor);
+
+    expected<void, int> v;
+    cy::reset();
+    auto tv = v.transform([] { return cy(7L); });
+    EXPECT_EQ(7L, tv->inner);
+    EXPECT_EQ(0, cy::n_move_ctor);
+
+    // nor need the result be movable
+    struct pinned {
+        long n;
+        constexpr explicit pinned(long n): n(n) {}
+        pinned(pinned&&) = delete;
+    };
+
+    auto p = expected<int, int>(2).transform([](int n) { return pinned(n*3L); });
+    EXPECT_EQ(6L, p->n);
+
+    auto pe = expected<int, int>(unexpect, 2).transform_error([](int n) { return pinned(n*4L); });
+    EXPECT_EQ(8L, pe.error().n);
+
+    auto pv = expected<void, int>(unexpect, 2).transform_error([](int n) { return pinned(n*5L); });
+    EXPECT_EQ(10L, pv.error().n);
+}
+
+TEST(expected, transform_in_place) {
+    using cv = counted<std::vector<int>>;
+    auto push = [](int n) { return [n](cv& v) { v.inner.push_back(n); }; };
+
+    // a void result: f is called on the value where it is held
+    expected<cv, int> e(in_place, std::vector<int>{1});
+    cv::reset();
+    expected<cv, int>& r = e.transform_in_place(push(2)).transform_in_place(push(3));
+    EXPECT_EQ(&e, &r);
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), e->inner);
+    EXPECT_EQ(0, cv::n_move_ctor);
+    EXPECT_EQ(0, cv::n_copy_ctor);
+    EXPECT_EQ(0, cv::n_move_assign);
+    EXPECT_EQ(0, cv::n_copy_assign);
+
+    // a non-void result is assigned back
+    e.transform_in_place([](const cv& v) { return cv(std::vector<int>(v.inner.rbegin(), v.inner.rend())); });
+    EXPECT_EQ((std::vector<int>{3, 2, 1}), e->inner);
+    EXPECT_EQ(1, cv::n_move_assign);
+    EXPECT_EQ(0, cv::n_copy_assign);
+
+    // the error is untouched by transform_in_place, and vice versa
+    expected<cv, int> u(unexpect, 4);
+    u.transform_in_place(push(5)).transform_error_in_place([](int& x) { x *= 2; });
+    ASSERT_FALSE(u.has_value());
+    EXPECT_EQ(8, u.error());
+    e.transform_error_in_place([](int& x) { x *= 2; });
+    EXPECT_EQ(3u, e->inner.size());
+
+    auto m = std::move(e).transform_in_place(push(0));
+    EXPECT_EQ((std::vector<int>{3, 2, 1, 0}), m->inner);
+
+    expected<void, std::string> v(unexpect, "a");
+    v.transform_error_in_place([](const std::string& s) { return s+"b"; });
+    EXPECT_EQ(unexpected(std::string("ab")), v);
+
+    int n = 1;
+    expected<int&, int> ref(n);
+    ref.transform_in_place([](int& x) { ++x; });
+    EXPECT_EQ(2, n);
+
+    static_assert(expected<int, int>(3).transform_in_place([](int& x) { x += 1; }).value() == 4);
+    static_assert(expected<int, int>(unexpect, 3).transform_error_in_place([](int x) { return x*2; }).error() == 6);
+}
+
 TEST(expected, swap) {
     int swaps = 0;
-    expected<Xswap, int> x1(in_place, -1, swaps), x2(in_place, -2, swaps);
+    expected<Xswap_nontrivial, int> x1(in_place, -1, swaps), x2(in_place, -2, swaps);
 
     using std::swap;
     swap(x1, x2);
@@ -946,20 +1577,249 @@ TEST(expected, swap) {
     EXPECT_EQ(1, swaps);
 
     swaps = 0;
-    expected<Xswap, int> x3(unexpect, 4);
+    expected<Xswap_nontrivial, int> x3(unexpect, 4);
     swap(x1, x3);
+    ASSERT_FALSE(x1.has_value());
+    ASSERT_TRUE(x3.has_value());
     EXPECT_EQ(4, x1.error());
     EXPECT_EQ(-2, x3->val);
     EXPECT_EQ(0, swaps); // Xswap is moved, not swapped.
 
+    swap(x1, x3);
+    ASSERT_TRUE(x1.has_value());
+    ASSERT_FALSE(x3.has_value());
+    EXPECT_EQ(-2, x1->val);
+    EXPECT_EQ(4, x3.error());
+    EXPECT_EQ(0, swaps);
+
+    // trivially copyable contents are swapped bytewise
+    swaps = 0;
+    expected<Xswap, int> t1(in_place, -1, swaps), t2(in_place, -2, swaps);
+    swap(t1, t2);
+    EXPECT_EQ(-2, t1->val);
+    EXPECT_EQ(-1, t2->val);
+    EXPECT_EQ(0, swaps);
+
+    expected<int, int> i1(3), i2(unexpect, 4);
+    swap(i1, i2);
+    EXPECT_EQ(unexpected(4), i1);
+    EXPECT_EQ(3, i2);
+    EXPECT_TRUE(std::is_nothrow_swappable_v<decltype(i1)>);
+
     swaps = 0;
     unexpected<Xswap> u1(in_place, -1, swaps), u2(in_place, -2, swaps);
     swap(u1, u2);
-    EXPECT_EQ(-2, u1.value().val);
-    EXPECT_EQ(-1, u2.value().val);
+    EXPECT_EQ(-2, u1.error().val);
+    EXPECT_EQ(-1, u2.error().val);
     EXPECT_EQ(1, swaps);
 
     EXPECT_TRUE(std::is_nothrow_swappable<unexpected<Xswap>>::value);
     EXPECT_FALSE(std::is_nothrow_swappable<unexpected<swap_can_throw>>::value);
 }
+
+TEST(expected, contract) {
+    using namespace backport;
+
+#if BACKPORT_EXPECTED_CONTRACT != BACKPORT_EXPECTED_CONTRACT_UNCHECKED && \
+    (BACKPORT_EXPECTED_CONTRACT == BACKPORT_EXPECTED_CONTRACT_TRAP || !defined(NDEBUG))
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+    expected<int, int> x(3), u(unexpect, 4);
+    EXPECT_EQ(3, *x);
+    EXPECT_EQ(4, u.error());
+    EXPECT_DEATH((void)*u, "");
+    EXPECT_DEATH((void)x.error(), "");
+    EXPECT_DEATH((void)std::move(u).operator*(), "");
+
+    expected<std::vector<int>, int> v(unexpect, 5);
+    EXPECT_DEATH((void)v->size(), "");
+
+    expected<void, int> w, wu(unexpect, 6);
+    EXPECT_DEATH((void)w.error(), "");
+    EXPECT_DEATH(*wu, "");
+#else
+    GTEST_SKIP() << "accessor contract checks disabled";
+#endif
+}
+
+namespace {
+using namespace backport;
+
+constexpr expected<int, std::errc> parse_digit(char c) {
+    if (c>='0' && c<='9') return c-'0';
+    return unexpected(std::errc::invalid_argument);
+}
+
+constexpr expected<int, std::errc> parse_digits(const char* s) {
+    expected<int, std::errc> acc(0);
+    for (; *s; ++s) {
+        acc = acc.and_then([c = *s](int n) { return parse_digit(c).transform([n](int d) { return 10*n+d; }); });
+        if (!acc) break;
+    }
+    return acc;
+}
+
+constexpr expected<int, std::errc> digit_table[] = {
+    parse_digit('0'), parse_digit('7'), parse_digit('x')
+};
+
+#if __cplusplus >= 202002L
+struct cx_nontrivial {
+    constexpr cx_nontrivial(int n) noexcept: n(n) {}
+    constexpr cx_nontrivial(const cx_nontrivial& x): n(x.n) {}
+    constexpr cx_nontrivial& operator=(const cx_nontrivial& x) { n = x.n; return *this; }
+    constexpr ~cx_nontrivial() {}
+    int n;
+};
+
+constexpr bool constexpr_mutation() {
+    expected<cx_nontrivial, int> x(3), u(unexpect, 4);
+    if (x->n!=3 || u.error()!=4) return false;
+
+    x = unexpected(5);
+    u = cx_nontrivial(6);
+    if (x.error()!=5 || u->n!=6) return false;
+
+    swap(x, u);
+    if (x->n!=6 || u.error()!=5) return false;
+
+    u.emplace(7);
+    if (u->n!=7) return false;
+
+    expected<int, boxed<int>> b(unexpect, 8), c(b);
+    if (c.error()!=8) return false;
+    c = 9;
+
+    expected<void, int> v;
+    v = unexpected(10);
+    if (v.error()!=10) return false;
+    v.emplace();
+
+    return c==9 && v.has_value();
+}
+#endif
+}
+
+TEST(expected, constexpr_eval) {
+    static_assert(parse_digits("123")==123);
+    static_assert(parse_digits("1x3").error()==std::errc::invalid_argument);
+    static_assert(*digit_table[1]==7 && !digit_table[2].has_value());
+
+    constexpr expected<int, int> x(2), u(unexpect, 3);
+    static_assert(x.value()==2 && u.error()==3);
+    static_assert(x.value_or(5)==2 && u.value_or(5)==5);
+    static_assert(x.error_or(5)==5 && u.error_or(5)==3);
+    static_assert(x.transform([](int n) { return n*2.; }) == 4.);
+    static_assert(u.or_else([](int e) { return expected<int, int>(e+1); }) == 4);
+    static_assert(u.transform_error([](int e) { return e*2L; }) == unexpected(6L));
+    static_assert(x != u);
+
+    constexpr expected<void, std::errc> v, w(unexpect, std::errc::invalid_argument);
+    static_assert(v.has_value() && !w.has_value());
+    static_assert(w.error_or(std::errc{})==std::errc::invalid_argument);
+    static_assert(v.and_then([] { return expected<int, std::errc>(1); }) == 1);
+
+#if __cplusplus >= 202002L
+    static_assert(constexpr_mutation());
 #endif
+    EXPECT_EQ(123, parse_digits("123"));
+}
+
+TEST(expected, relocate) {
+    using namespace backport;
+
+    static_assert(is_trivially_relocatable_v<expected<int, std::errc>>);
+    static_assert(is_trivially_relocatable_v<expected<double, boxed<std::vector<int>>>>);
+    static_assert(is_trivially_relocatable_v<expected<int&, boxed<std::vector<int>>>>);
+    static_assert(is_trivially_relocatable_v<expected<void, boxed<std::vector<int>>>>);
+    static_assert(is_trivially_relocatable_v<unexpected<boxed<std::vector<int>>>>);
+    static_assert(!is_trivially_relocatable_v<expected<std::vector<int>, int>>);
+    static_assert(!is_trivially_relocatable_v<expected<void, std::vector<int>>>);
+    static_assert(!is_trivially_relocatable_v<unexpected<std::vector<int>>>);
+
+    {
+        using ex = expected<int, boxed<std::vector<int>>>;
+        alignas(ex) unsigned char src[3*sizeof(ex)], dst[3*sizeof(ex)];
+        ex* a = reinterpret_cast<ex*>(src);
+        ex* b = reinterpret_cast<ex*>(dst);
+
+        ::new (a) ex(1);
+        ::new (a+1) ex(unexpect, std::vector<int>{2, 3});
+        ::new (a+2) ex(4);
+
+        ex* e = relocate_n(a, 3, b);
+        EXPECT_EQ(b+3, e);
+        EXPECT_EQ(1, b[0]);
+        EXPECT_EQ(unexpected(std::vector<int>{2, 3}), b[1]);
+        EXPECT_EQ(4, b[2]);
+        std::destroy_n(b, 3);
+    }
+
+    {
+        struct vec {
+            std::vector<int> v;
+            vec(std::vector<int> v): v(std::move(v)) {}
+            vec(const vec&) = default;
+            vec(vec&& other) noexcept(false): v(std::move(other.v)) {}
+        };
+
+        using cv = counted<vec>;
+        using ex = expected<cv, int>;
+        alignas(ex) unsigned char src[2*sizeof(ex)], dst[2*sizeof(ex)];
+        ex* a = reinterpret_cast<ex*>(src);
+        ex* b = reinterpret_cast<ex*>(dst);
+
+        ::new (a) ex(std::in_place, std::vector<int>{1});
+        ::new (a+1) ex(unexpect, 2);
+
+        // the move constructor is not noexcept: relocate_n copies
+        cv::reset();
+        relocate_n(a, 2, b);
+        EXPECT_EQ(0u, cv::n_move_ctor);
+        EXPECT_EQ(1u, cv::n_copy_ctor);
+        EXPECT_EQ(std::vector<int>{1}, b[0]->inner.v);
+        EXPECT_EQ(2, b[1].error());
+        std::destroy_n(b, 2);
+    }
+
+    {
+        using ex = expected<std::vector<int>, int>;
+        alignas(ex) unsigned char src[2*sizeof(ex)], dst[2*sizeof(ex)];
+        ex* a = reinterpret_cast<ex*>(src);
+        ex* b = reinterpret_cast<ex*>(dst);
+
+        ::new (a) ex(std::vector<int>{1, 2});
+        ::new (a+1) ex(unexpect, 3);
+        const int* p = a->value().data();
+
+        relocate_n(a, 2, b);
+        EXPECT_EQ(p, b->value().data());
+        EXPECT_EQ(3, b[1].error());
+        std::destroy_n(b, 2);
+    }
+
+    {
+        // if a copy throws, the source objects are left intact
+        struct thrower {
+            int v;
+            explicit thrower(int v): v(v) {}
+            thrower(const thrower& other): v(other.v) { if (v==2) throw 0; }
+        };
+        static_assert(!std::is_nothrow_move_constructible_v<thrower>);
+
+        using ex = expected<thrower, std::vector<int>>;
+        alignas(ex) unsigned char src[3*sizeof(ex)], dst[3*sizeof(ex)];
+        ex* a = reinterpret_cast<ex*>(src);
+        ex* b = reinterpret_cast<ex*>(dst);
+
+        ::new (a) ex(unexpect, std::vector<int>{1});
+        ::new (a+1) ex(std::in_place, 1);
+        ::new (a+2) ex(std::in_place, 2);
+
+        EXPECT_ANY_THROW(relocate_n(a, 3, b));
+        EXPECT_EQ(std::vector<int>{1}, a[0].error());
+        EXPECT_EQ(1, a[1]->v);
+        EXPECT_EQ(2, a[2]->v);
+        std::destroy_n(a, 3);
+    }
+}
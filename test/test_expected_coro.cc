@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+
+// Coroutine support requires C++20.
+#if defined(__cpp_impl_coroutine)
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <backport/expected_coro.h>
+#include "common.h"
+
+using backport::expected;
+using backport::unexpect;
+using backport::unexpected;
+
+namespace {
+
+expected<int, std::string> parse(const std::string& s) {
+    if (s.empty() || s.find_first_not_of("0123456789")!=std::string::npos) return unexpected("bad: "+s);
+    return std::stoi(s);
+}
+
+expected<int, std::string> sum(const std::string& a, const std::string& b, int& reached) {
+    int x = co_await parse(a);
+    ++reached;
+    int y = co_await parse(b);
+    ++reached;
+    co_return x+y;
+}
+
+// counts live instances, to check that locals are destroyed on early return
+struct tracker {
+    static inline int live = 0;
+    tracker() { ++live; }
+    ~tracker() { --live; }
+};
+
+expected<void, int> check_all(const expected<int, int>* p, std::size_t n, int& count) {
+    tracker t;
+    for (std::size_t i = 0; i<n; ++i) {
+        co_await p[i];
+        ++count;
+    }
+    co_return {};
+}
+
+expected<void, int> fail_with(int e) {
+    co_return unexpected(e);
+}
+
+struct no_default {
+    explicit no_default(int n): n(n) {}
+    int n;
+};
+
+expected<no_default, int> make_no_default(expected<int, int> x) {
+    co_return no_default(co_await std::move(x));
+}
+
+expected<int, long> widen(expected<int, int> x) {
+    co_return 2*co_await x;
+}
+
+expected<int, int> throws(bool really) {
+    if (really) throw std::runtime_error("thrown");
+    co_return 1;
+}
+
+} // anonymous namespace
+
+TEST(expected_coro, value_and_error) {
+    int reached = 0;
+    EXPECT_EQ(7, sum("3", "4", reached));
+    EXPECT_EQ(2, reached);
+
+    reached = 0;
+    EXPECT_EQ(unexpected("bad: x"), sum("x", "4", reached));
+    EXPECT_EQ(0, reached);
+
+    reached = 0;
+    EXPECT_EQ(unexpected("bad: y"), sum("3", "y", reached));
+    EXPECT_EQ(1, reached);
+
+    EXPECT_EQ(no_default(3).n, make_no_default(3)->n);
+    EXPECT_EQ(unexpected(5), make_no_default(expected<int, int>(unexpect, 5)));
+
+    // error converted to the coroutine's error type
+    EXPECT_EQ(6, widen(3));
+    expected<int, long> w = widen(expected<int, int>(unexpect, 4));
+    EXPECT_EQ(unexpected(4l), w);
+}
+
+TEST(expected_coro, void_result) {
+    expected<int, int> xs[] = {1, 2, expected<int, int>(unexpect, 3), 4};
+
+    int count = 0;
+    EXPECT_TRUE(check_all(xs, 2, count).has_value());
+    EXPECT_EQ(2, count);
+    EXPECT_EQ(0, tracker::live);
+
+    count = 0;
+    EXPECT_EQ(unexpected(3), check_all(xs, 4, count));
+    EXPECT_EQ(2, count);
+    EXPECT_EQ(0, tracker::live);
+
+    EXPECT_EQ(unexpected(9), fail_with(9));
+}
+
+TEST(expected_coro, exceptions) {
+    EXPECT_EQ(1, throws(false));
+    EXPECT_THROW(throws(true), std::runtime_error);
+}
+
+TEST(expected_coro, conversion_order) {
+    // The return object may be converted to the result before the coroutine
+    // body runs (result bound to the promise) or after (result pending in the
+    // return object); drive the promise directly to check both orders.
+    using ex = expected<no_default, int>;
+    using promise = std::coroutine_traits<ex>::promise_type;
+
+    {
+        promise p;
+        ex r = p.get_return_object();
+        EXPECT_EQ(&r, p.slot_);
+        p.return_value(no_default(4));
+        EXPECT_EQ(4, r->n);
+    }
+    {
+        promise p;
+        ex r = p.get_return_object();
+        p.return_error(5);
+        EXPECT_EQ(unexpected(5), r);
+    }
+    {
+        promise p;
+        auto ret = p.get_return_object();
+        p.return_value(no_default(6));
+        ex r = std::move(ret);
+        EXPECT_EQ(6, r->n);
+    }
+}
+
+namespace {
+
+using cs = counted<std::string>;
+
+expected<std::size_t, cs> length(expected<cs, cs> x) {
+    co_return (co_await std::move(x)).inner.size();
+}
+
+expected<std::size_t, cs> length_ref(const expected<cs, cs>& x) {
+    const cs& s = co_await x;
+    co_return s.inner.size();
+}
+
+} // anonymous namespace
+
+TEST(expected_coro, moves) {
+    cs::reset();
+    expected<cs, cs> a(std::in_place, "abc");
+    EXPECT_EQ(3u, length_ref(a));
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(0u, cs::n_move_ctor);
+
+    // awaiting an rvalue moves the value out
+    cs::reset();
+    EXPECT_EQ(3u, length(std::move(a)));
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+
+    // errors are moved, never copied
+    cs::reset();
+    expected<cs, cs> b(unexpect, "err");
+    auto r = length(std::move(b));
+    ASSERT_FALSE(r);
+    EXPECT_EQ("err", r.error().inner);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(0u, cs::n_copy_assign);
+}
+
+namespace {
+
+struct arena {
+    std::size_t n_alloc = 0;
+    std::size_t n_dealloc = 0;
+    std::size_t live_bytes = 0;
+};
+
+template <typename T>
+struct arena_allocator {
+    using value_type = T;
+
+    arena* a;
+
+    explicit arena_allocator(arena& a): a(&a) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other): a(other.a) {}
+
+    T* allocate(std::size_t n) {
+        ++a->n_alloc;
+        a->live_bytes += n*sizeof(T);
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        ++a->n_dealloc;
+        a->live_bytes -= n*sizeof(T);
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    friend bool operator==(const arena_allocator& x, const arena_allocator& y) { return x.a==y.a; }
+    friend bool operator!=(const arena_allocator& x, const arena_allocator& y) { return x.a!=y.a; }
+};
+
+expected<int, int> halve(std::allocator_arg_t, const arena_allocator<char>&, expected<int, int> x) {
+    int n = co_await x;
+    if (n%2) co_return unexpected(n);
+    co_return n/2;
+}
+
+} // anonymous namespace
+
+TEST(expected_coro, allocator) {
+    arena ar;
+    arena_allocator<char> alloc(ar);
+
+    EXPECT_EQ(4, halve(std::allocator_arg, alloc, 8));
+    EXPECT_EQ(1u, ar.n_alloc);
+    EXPECT_EQ(1u, ar.n_dealloc);
+    EXPECT_EQ(0u, ar.live_bytes);
+
+    EXPECT_EQ(unexpected(3), halve(std::allocator_arg, alloc, 3));
+    EXPECT_EQ(unexpected(5), halve(std::allocator_arg, alloc, expected<int, int>(unexpect, 5)));
+    EXPECT_EQ(3u, ar.n_alloc);
+    EXPECT_EQ(3u, ar.n_dealloc);
+    EXPECT_EQ(0u, ar.live_bytes);
+}
+
+#endif // defined(__cpp_impl_coroutine)
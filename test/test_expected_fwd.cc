@@ -0,0 +1,50 @@
+// expected_fwd.h must not include any standard library header, so it is
+// included here before anything else.
+
+#include <backport/expected_fwd.h>
+
+#if defined(_GLIBCXX_TYPE_TRAITS) || defined(_GLIBCXX_UTILITY)
+#error "expected_fwd.h includes standard library headers"
+#endif
+
+namespace {
+
+struct fwd_error;
+
+// expected of incomplete types, passed through by reference
+backport::expected<int, fwd_error>& pass_through(backport::expected<int, fwd_error>& x) {
+    return x;
+}
+
+backport::expected<void, fwd_error>* pass_void(backport::expected<void, fwd_error>* x) {
+    return x;
+}
+
+constexpr backport::unexpect_t tag = backport::unexpect;
+
+} // anonymous namespace
+
+#include <gtest/gtest.h>
+
+#include <type_traits>
+
+#include <backport/expected.h>
+
+namespace {
+
+struct fwd_error { int code; };
+
+} // anonymous namespace
+
+TEST(expected_fwd, declarations) {
+    backport::expected<int, fwd_error> x(tag, fwd_error{3});
+    EXPECT_EQ(&x, &pass_through(x));
+    EXPECT_EQ(3, pass_through(x).error().code);
+
+    backport::expected<void, fwd_error> v;
+    EXPECT_TRUE(pass_void(&v)->has_value());
+
+    // the default third argument selects the specialization for void
+    EXPECT_TRUE((std::is_same_v<backport::expected<const void, int>, backport::expected<const void, int, true>>));
+    EXPECT_TRUE((std::is_same_v<backport::expected<int, int>, backport::expected<int, int, false>>));
+}
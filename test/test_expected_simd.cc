@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <string>
+
+#include <backport/expected_simd.h>
+
+using backport::expected;
+using backport::expected_simd;
+using backport::unexpect;
+using backport::unexpected;
+
+namespace {
+enum class err { none, negative, overflow };
+
+using batch = expected_simd<double, err, 4>;
+
+expected<double, err> checked_sqrt(double x) {
+    if (x<0) return unexpected(err::negative);
+    return std::sqrt(x);
+}
+}
+
+TEST(expected_simd, ctors) {
+    batch a;
+    EXPECT_TRUE(a.all_values());
+    EXPECT_EQ(4u, a.count_values());
+    EXPECT_EQ(0., *a[3]);
+
+    batch b(2.5);
+    EXPECT_EQ(2.5, *b[0]);
+    EXPECT_EQ(2.5, *b[3]);
+
+    expected<double, err> xs[4] = {1., unexpected(err::overflow), 3., unexpected(err::negative)};
+    batch c(xs);
+    EXPECT_FALSE(c.all_values());
+    EXPECT_TRUE(c.any_value());
+    EXPECT_EQ(2u, c.count_values());
+    for (int i = 0; i<4; ++i) EXPECT_EQ(xs[i], c[i]);
+
+    c.set_value(1, 2.);
+    c.set_error(2, err::negative);
+    expected<double, err> ys[4];
+    c.store(ys);
+    EXPECT_EQ(2., ys[1]);
+    EXPECT_EQ(unexpected(err::negative), ys[2]);
+    EXPECT_EQ(err::none, c.errors()[1]);
+}
+
+TEST(expected_simd, monadic) {
+    expected<double, err> xs[4] = {4., unexpected(err::overflow), -9., 16.};
+    batch a(xs);
+
+    auto t = a.transform([](double x) { return x*2; });
+    EXPECT_EQ(8., t[0]);
+    EXPECT_EQ(unexpected(err::overflow), t[1]);
+    EXPECT_EQ(-18., t[2]);
+
+    auto r = a.and_then(checked_sqrt);
+    EXPECT_EQ(2., r[0]);
+    EXPECT_EQ(unexpected(err::overflow), r[1]);
+    EXPECT_EQ(unexpected(err::negative), r[2]);
+    EXPECT_EQ(4., r[3]);
+    EXPECT_EQ((std::array<bool, 4>{true, false, false, true}), r.mask());
+
+    EXPECT_EQ((std::array<double, 4>{2., -1., -1., 4.}), r.value_or(-1.));
+    EXPECT_EQ((std::array<err, 4>{err::none, err::overflow, err::negative, err::none}), r.error_or(err::none));
+
+    auto s = r.transform_error([](err e) { return e==err::negative? std::string("neg"): std::string("other"); });
+    EXPECT_EQ(unexpected(std::string("other")), s[1]);
+    EXPECT_EQ(unexpected(std::string("neg")), s[2]);
+    EXPECT_EQ("", s.errors()[0]);
+
+    auto o = r.or_else([](err e) { return e==err::negative? expected<double, int>(0.): expected<double, int>(unexpect, int(e)); });
+    EXPECT_EQ(2., o[0]);
+    EXPECT_EQ(unexpected(int(err::overflow)), o[1]);
+    EXPECT_EQ(0., o[2]);
+    EXPECT_EQ(4., o[3]);
+}
+
+TEST(expected_simd, constexpr_eval) {
+    using ib = expected_simd<int, int, 8>;
+    constexpr ib a = ib(3).transform([](int x) { return x+1; });
+    static_assert(a.all_values() && a.values()[7]==4);
+    static_assert(a.and_then([](int x) { return x>3? expected<int, int>(unexpect, x): expected<int, int>(x); }).count_values()==0);
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <backport/expected_vector.h>
+
+using backport::expected;
+using backport::expected_vector;
+using backport::unexpect;
+using backport::unexpected;
+
+TEST(expected_vector, push_back) {
+    using ev = expected_vector<double, std::string>;
+    using ex = ev::value_type;
+
+    ev v;
+    EXPECT_TRUE(v.empty());
+    EXPECT_EQ(v.size(), v.first_error());
+
+    v.push_back(1.5);
+    v.push_back(unexpected(std::string("bad")));
+    v.emplace_back(2.5);
+    v.push_back_error("worse");
+
+    ASSERT_EQ(4u, v.size());
+    EXPECT_TRUE(v.has_value(0));
+    EXPECT_FALSE(v.has_value(1));
+    EXPECT_TRUE(v[2]);
+    EXPECT_FALSE(v[3]);
+
+    EXPECT_EQ(1.5, *v[0]);
+    EXPECT_EQ("bad", v[1].error());
+    EXPECT_EQ(2.5, v[2].value());
+    EXPECT_EQ("worse", v[3].error());
+    EXPECT_THROW(v[3].value(), backport::bad_expected_access<std::string>);
+
+    EXPECT_EQ(ex(1.5), ex(v[0]));
+    EXPECT_EQ(ex(unexpect, "bad"), ex(v[1]));
+
+    v.pop_back();
+    EXPECT_EQ(3u, v.size());
+    EXPECT_EQ(1u, v.count_errors());
+
+    ev w{ex(1.), ex(unexpect, "x"), ex(3.)};
+    EXPECT_EQ(3u, w.size());
+    EXPECT_EQ("x", w[1].error());
+}
+
+namespace {
+// constructible from a negative int only by throwing
+struct checked {
+    int n = 0;
+    checked() = default;
+    explicit checked(int n): n(n) { if (n<0) throw n; }
+};
+}
+
+TEST(expected_vector, exception_safety) {
+    using ev = expected_vector<checked, checked>;
+
+    // a failed append leaves the mask in step with the elements, in
+    // particular when it would have started a new mask word
+    for (std::size_t n: {0u, 10u, 64u, 128u}) {
+        ev v;
+        for (std::size_t i = 0; i<n; ++i) v.emplace_back(1);
+
+        EXPECT_THROW(v.emplace_back(-1), int);
+        EXPECT_THROW(v.push_back_error(-1), int);
+        ASSERT_EQ(n, v.size());
+        EXPECT_EQ((n+63)/64, v.value_mask().size());
+        EXPECT_EQ(0u, v.count_errors());
+
+        v.push_back_error(2);
+        v.emplace_back(3);
+        ASSERT_EQ(n+2, v.size());
+        EXPECT_EQ((n+2+63)/64, v.value_mask().size());
+        EXPECT_FALSE(v.has_value(n));
+        EXPECT_EQ(2, v[n].error().n);
+        EXPECT_TRUE(v.has_value(n+1));
+        EXPECT_EQ(3, v[n+1]->n);
+
+        v.pop_back();
+        v.pop_back();
+        EXPECT_EQ((n+63)/64, v.value_mask().size());
+        EXPECT_EQ(0u, v.count_errors());
+    }
+}
+
+TEST(expected_vector, assign) {
+    using ev = expected_vector<int, int>;
+
+    ev v{1, 2, 3, 4};
+    v[2] = unexpected(30);
+    v[0] = unexpected(10);
+    EXPECT_EQ(2u, v.count_errors());
+    EXPECT_EQ(0u, v.first_error());
+    EXPECT_EQ(10, v[0].error());
+    EXPECT_EQ(30, v[2].error());
+
+    v[0] = 5;
+    EXPECT_EQ(5, *v[0]);
+    EXPECT_EQ(2u, v.first_error());
+
+    v[2] = unexpected(31);
+    EXPECT_EQ(31, v[2].error());
+    EXPECT_EQ(1u, v.count_errors());
+
+    v[1] = v[2];
+    EXPECT_EQ(31, v[1].error());
+    EXPECT_EQ(1u, v.first_error());
+
+    *v[3] += 10;
+    EXPECT_EQ(14, v[3].value());
+
+    std::vector<expected<int, int>> xs;
+    for (auto r: std::as_const(v)) xs.push_back(r);
+    std::vector<expected<int, int>> expect{5, unexpected(31), unexpected(31), 14};
+    EXPECT_EQ(expect, xs);
+}
+
+TEST(expected_vector, bulk) {
+    using ev = expected_vector<double, int>;
+
+    ev v;
+    for (int i = 0; i<200; ++i) {
+        if (i%7==3) v.push_back_error(i);
+        else v.emplace_back(i*0.5);
+    }
+
+    unsigned n_err = 0;
+    for (int i = 0; i<200; ++i) n_err += i%7==3;
+
+    EXPECT_EQ(n_err, v.count_errors());
+    EXPECT_EQ(200u-n_err, v.count_values());
+    EXPECT_EQ(3u, v.first_error());
+
+    auto values = v.values_span();
+    ASSERT_EQ(200u, values.size());
+    EXPECT_EQ(0.5, values[1]);
+    EXPECT_EQ(0., values[3]);
+    EXPECT_EQ(99., values[198]);
+
+    auto mask = v.value_mask();
+    ASSERT_EQ(4u, mask.size());
+    unsigned n_set = 0;
+    for (auto w: mask) n_set += __builtin_popcountll(w);
+    EXPECT_EQ(v.count_values(), n_set);
+    EXPECT_EQ(0u, mask[3]>>8);
+
+    auto errors = v.errors();
+    ASSERT_EQ(n_err, errors.size());
+    for (auto& [i, e]: errors) {
+        EXPECT_EQ(3u, i%7);
+        EXPECT_EQ(int(i), e);
+    }
+
+    while (v.size()>3) v.pop_back();
+    EXPECT_EQ(1u, v.value_mask().size());
+    EXPECT_EQ(0b111u, v.value_mask()[0]);
+    EXPECT_EQ(0u, v.count_errors());
+    EXPECT_EQ(3u, v.first_error());
+}
@@ -0,0 +1,90 @@
+// Tests for builds without exceptions: compiled with -fno-exceptions, with
+// failures reported through the failure handler.
+
+#define BACKPORT_EXPECTED_FAILURE BACKPORT_EXPECTED_FAILURE_HOOK
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <backport/collect.h>
+#include <backport/expected.h>
+#if defined(__cpp_impl_coroutine)
+#include <backport/expected_coro.h>
+#endif
+#include <backport/expected_simd.h>
+#include <backport/expected_vector.h>
+#include <backport/pipeline.h>
+#include <backport/traced.h>
+#include <backport/try.h>
+#include <backport/try_invoke.h>
+
+using backport::expected;
+using backport::expected_vector;
+using backport::unexpect;
+using backport::unexpected;
+
+static_assert(!BACKPORT_EXPECTED_EXCEPTIONS, "test requires a build without exceptions");
+
+// tracing is disabled by default, and traced<E> is then E
+static_assert(std::is_same_v<int, backport::traced<int>>);
+static_assert(std::is_same_v<backport::unexpected<int>, decltype(backport::unexpected_traced(1))>);
+
+namespace {
+
+void report(const std::exception& e) {
+    if (auto p = dynamic_cast<const backport::bad_expected_access<int>*>(&e)) {
+        std::fprintf(stderr, "failure: error %d\n", p->error());
+    }
+    else {
+        std::fprintf(stderr, "failure: %s\n", e.what());
+    }
+}
+
+} // anonymous namespace
+
+TEST(noexcept, operations) {
+    expected<std::string, int> x("abc"), y(unexpect, 3);
+    EXPECT_EQ("abc", x.value());
+
+    x.swap(y);
+    EXPECT_EQ(unexpected(3), x);
+    EXPECT_EQ("abc", y);
+
+    expected_vector<int, int> v{1, unexpected(2), 3};
+    EXPECT_EQ(3, v[2].value());
+
+    std::vector<expected<int, int>> xs = {1, 2, 3};
+    auto c = backport::collect(xs.begin(), xs.end());
+    EXPECT_EQ(3u, c->size());
+
+    EXPECT_EQ(2, backport::try_invoke<std::exception_ptr>([] { return 2; }));
+}
+
+TEST(noexcept, failure) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+    expected<int, int> x(unexpect, 4);
+    expected<void, int> u(unexpect, 5);
+    expected_vector<int, int> v{unexpected(6)};
+
+    backport::set_failure_handler(nullptr);
+    EXPECT_DEATH(x.value(), "");
+
+    backport::set_failure_handler(report);
+    EXPECT_DEATH(x.value(), "failure: error 4");
+    EXPECT_DEATH(std::move(x).value(), "failure: error 4");
+    EXPECT_DEATH(u.value(), "failure: error 5");
+    EXPECT_DEATH(v[0].value(), "failure: error 6");
+
+    auto factory = [](int e) { return std::runtime_error("code "+std::to_string(e)); };
+    EXPECT_DEATH(backport::value_or_throw(x, factory), "failure: code 4");
+
+    EXPECT_EQ(report, backport::set_failure_handler(nullptr));
+}
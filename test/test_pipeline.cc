@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+
+#include <backport/pipeline.h>
+#include "common.h"
+
+using backport::expected;
+using backport::unexpect;
+using backport::unexpected;
+
+namespace bp = backport;
+
+TEST(pipeline, eval) {
+    using ex = expected<int, std::string>;
+
+    auto half = [](int n) -> ex {
+        if (n%2) return unexpected("odd");
+        return n/2;
+    };
+    auto twice = [](int n) { return 2.0*n; };
+    auto recover = [](const std::string& s) -> expected<double, int> { return s=="odd"? expected<double, int>(-1.): expected<double, int>(unexpect, 1); };
+
+    ex a(12), b(7), c(unexpect, "bad");
+
+    expected<double, int> r = a | bp::and_then(half) | bp::and_then(half) | bp::transform(twice) | bp::or_else(recover);
+    EXPECT_EQ(6., r);
+
+    r = b | bp::and_then(half) | bp::transform(twice) | bp::or_else(recover);
+    EXPECT_EQ(-1., r);
+
+    r = c | bp::and_then(half) | bp::transform(twice) | bp::or_else(recover);
+    EXPECT_EQ(unexpected(1), r);
+
+    auto p = c | bp::transform(twice) | bp::transform_error([](const std::string& s) { return s.size(); });
+    static_assert(std::is_same_v<expected<double, std::size_t>, decltype(std::move(p).run())>);
+    EXPECT_EQ(unexpected(3u), std::move(p).run());
+
+    // source held by reference: not evaluated until run
+    ex d(4);
+    auto q = d | bp::transform([](int n) { return n+1; });
+    d = 10;
+    EXPECT_EQ(11, std::move(q).run());
+
+    // void values
+    expected<void, int> v;
+    int calls = 0;
+    expected<int, int> w = v | bp::transform([&] { ++calls; }) | bp::and_then([&]() -> expected<int, int> { return ++calls; });
+    EXPECT_EQ(2, w);
+}
+
+TEST(pipeline, moves) {
+    using cs = counted<std::string>;
+    using ex = expected<cs, int>;
+
+    auto append = [](cs&& s) { return cs(std::move(s.inner)+"x"); };
+    auto check = [](cs&& s) -> ex { return ex(std::in_place, std::move(s.inner)); };
+
+    // eager evaluation: each step constructs a new expected, with the
+    // function's result constructed in place
+    {
+        ex e(std::in_place, "a");
+        cs::reset();
+        ex r = std::move(e).transform(append).transform(append).and_then(check).transform(append);
+        EXPECT_EQ("axxx", r->inner);
+        EXPECT_EQ(0u, cs::n_move_ctor);
+        EXPECT_EQ(0u, cs::n_copy_ctor);
+    }
+
+    // fused evaluation: intermediate values are passed directly, and the
+    // final transform constructs the result in place
+    {
+        ex e(std::in_place, "a");
+        cs::reset();
+        ex r = std::move(e) | bp::transform(append) | bp::transform(append) | bp::and_then(check) | bp::transform(append);
+        EXPECT_EQ("axxx", r->inner);
+        EXPECT_EQ(0u, cs::n_move_ctor);
+        EXPECT_EQ(0u, cs::n_copy_ctor);
+    }
+
+    // likewise for a final transform_error
+    {
+        using ey = expected<int, cs>;
+        auto mark = [](cs&& s) { return cs(std::move(s.inner)+"!"); };
+
+        ey e(unexpect, "b");
+        cs::reset();
+        ey r = std::move(e) | bp::transform_error(mark) | bp::transform([](int n) { return n; }) | bp::transform_error(mark);
+        EXPECT_EQ("b!!", r.error().inner);
+        EXPECT_EQ(0u, cs::n_move_ctor);
+        EXPECT_EQ(0u, cs::n_copy_ctor);
+    }
+}
+
+TEST(pipeline, constexpr_eval) {
+    constexpr auto f = [] {
+        expected<int, int> e(3);
+        return (e | bp::transform([](int n) { return n*n; }) | bp::and_then([](int n) { return expected<long, int>(n+1L); })).run();
+    };
+    static_assert(f()==10L);
+}
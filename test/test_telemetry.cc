@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+// Telemetry changes the definitions of the expected and unexpected
+// constructors; to keep them distinct from those in other test translation
+// units, only error types local to this file are used here.
+
+#define BACKPORT_EXPECTED_TELEMETRY 1
+
+#include <string>
+#include <thread>
+
+#include <backport/expected.h>
+#include <backport/telemetry.h>
+
+using backport::expected;
+using backport::unexpect;
+using backport::unexpected;
+
+namespace {
+
+enum class tm_error { a, b };
+struct tm_other { int code; };
+
+expected<int, tm_error> fail(tm_error e) {
+    return unexpected(e);
+}
+
+expected<int, tm_error> pass_on(tm_error e) {
+    auto r = fail(e);
+    if (!r) return unexpected(r.error());
+    return r;
+}
+
+std::string line_for(const std::string& snapshot, const std::string& prefix) {
+    auto i = snapshot.find(prefix);
+    if (i==std::string::npos) return "";
+    return snapshot.substr(i, snapshot.find('\n', i)-i);
+}
+
+} // anonymous namespace
+
+TEST(telemetry, counters) {
+    auto type_a = std::string(backport::error_type_of<tm_error>().name);
+    auto type_b = std::string(backport::error_type_of<tm_other>().name);
+    EXPECT_NE(std::string::npos, type_a.find("tm_error"));
+    EXPECT_NE(std::string::npos, type_b.find("tm_other"));
+
+    // nothing recorded without a hook
+    (void)fail(tm_error::a);
+
+    backport::error_counters::install();
+
+    (void)fail(tm_error::a);
+    (void)pass_on(tm_error::b);
+    std::thread([] {
+        (void)fail(tm_error::a);
+        expected<int, tm_error> x(unexpect, tm_error::b);
+        (void)x.transform_error([](tm_error) { return tm_other{1}; });
+    }).join();
+
+    // values are not counted
+    expected<int, tm_error> v(3);
+    (void)v.transform_error([](tm_error) { return tm_other{2}; });
+
+    std::string snap = backport::error_counters::snapshot();
+    backport::error_counters::uninstall();
+
+    std::string prefix_a = "backport_expected_errors{type=\""+type_a+"\"";
+    EXPECT_EQ(prefix_a+",event=\"unexpected\"} 4", line_for(snap, prefix_a+",event=\"unexpected\""));
+    EXPECT_EQ(prefix_a+",event=\"expected\"} 5", line_for(snap, prefix_a+",event=\"expected\""));
+    EXPECT_EQ(prefix_a+",event=\"transform_error\"} 1", line_for(snap, prefix_a+",event=\"transform_error\""));
+
+    std::string prefix_b = "backport_expected_errors{type=\""+type_b+"\"";
+    EXPECT_EQ(prefix_b+",event=\"expected\"} 1", line_for(snap, prefix_b+",event=\"expected\""));
+
+    // no histograms without sampling
+    EXPECT_EQ(std::string::npos, snap.find("propagation_ns"));
+}
+
+namespace {
+
+struct tm_sampled { int code; };
+
+expected<int, tm_sampled> fail_deep(int depth) {
+    if (!depth) return unexpected(tm_sampled{0});
+    auto r = fail_deep(depth-1);
+    if (!r) return unexpected(r.error());
+    return r;
+}
+
+} // anonymous namespace
+
+TEST(telemetry, sampling) {
+    auto type = std::string(backport::error_type_of<tm_sampled>().name);
+
+    backport::error_counters::install(1);
+    (void)fail_deep(0);
+    std::string snap = backport::error_counters::snapshot();
+    backport::error_counters::uninstall();
+
+    // every unexpected starts a sample, recorded at the construction of the
+    // expected that returns it
+    std::string count = "backport_expected_propagation_ns_count{type=\""+type+"\"}";
+    EXPECT_EQ(count+" 1", line_for(snap, count));
+
+    std::string inf = "backport_expected_propagation_ns_bucket{type=\""+type+"\",le=\"+Inf\"}";
+    EXPECT_EQ(inf+" 1", line_for(snap, inf));
+}
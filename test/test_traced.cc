@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#define BACKPORT_EXPECTED_TRACE 1
+#define BACKPORT_EXPECTED_TRACE_FRAMES 4
+#define BACKPORT_EXPECTED_TRACE_BUFFER 8
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <backport/traced.h>
+
+using backport::expected;
+using backport::traced;
+using backport::unexpect;
+using backport::unexpected;
+
+namespace {
+
+enum class parse_error { empty, bad_digit };
+
+unsigned fail_line = 0;
+
+expected<int, traced<parse_error>> parse(const std::string& s) {
+    fail_line = __LINE__+1;
+    if (s.empty()) return backport::unexpected_traced(parse_error::empty);
+    int n = 0;
+    for (char c: s) {
+        fail_line = __LINE__+1;
+        if (c<'0' || c>'9') return unexpected(traced<parse_error>(parse_error::bad_digit));
+        n = 10*n+(c-'0');
+    }
+    return n;
+}
+
+} // anonymous namespace
+
+TEST(traced, record) {
+    EXPECT_EQ(12, parse("12"));
+
+    auto r = parse("");
+    ASSERT_FALSE(r);
+    EXPECT_EQ(parse_error::empty, r.error());
+    EXPECT_EQ(unexpected(traced<parse_error>(parse_error::empty)), r);
+
+    const backport::trace_record* t = r.error().trace();
+    ASSERT_TRUE(t);
+    EXPECT_EQ(fail_line, t->where.line);
+    EXPECT_TRUE(std::strstr(t->where.file, "test_traced.cc"));
+    EXPECT_TRUE(std::strstr(t->where.function, "parse"));
+    EXPECT_GT(t->n_frames, 0u);
+
+    r = parse("1x");
+    ASSERT_FALSE(r);
+    EXPECT_EQ(parse_error::bad_digit, r.error().get());
+    t = r.error().trace();
+    ASSERT_TRUE(t);
+    EXPECT_EQ(fail_line, t->where.line);
+
+    // copies share the record
+    auto copy = r;
+    EXPECT_EQ(t, copy.error().trace());
+}
+
+TEST(traced, no_implicit_conversion) {
+    using ex = expected<int, traced<parse_error>>;
+
+    // 'return unexpected(e);' would convert e to traced<E> within expected,
+    // recording a location in the library, and so does not compile
+    static_assert(!std::is_convertible_v<unexpected<parse_error>, ex>);
+    static_assert(!std::is_convertible_v<const unexpected<parse_error>&, ex>);
+    static_assert(!std::is_assignable_v<ex&, unexpected<parse_error>>);
+    static_assert(!std::is_convertible_v<parse_error, traced<parse_error>>);
+
+    static_assert(std::is_convertible_v<unexpected<traced<parse_error>>, ex>);
+    static_assert(std::is_assignable_v<ex&, unexpected<traced<parse_error>>>);
+
+    // the location of the return statement is recorded
+    auto f = []() -> ex { return unexpected(traced<parse_error>(parse_error::empty)); };
+    unsigned line = __LINE__-1;
+    ex r = f();
+    ASSERT_TRUE(r.error().trace());
+    EXPECT_EQ(line, r.error().trace()->where.line);
+    EXPECT_TRUE(std::strstr(r.error().trace()->where.file, "test_traced.cc"));
+}
+
+TEST(traced, ring_buffer) {
+    auto r = parse("");
+    ASSERT_TRUE(r.error().trace());
+
+    // records are overwritten once the buffer wraps
+    for (int i = 0; i<8; ++i) (void)parse("x");
+    EXPECT_FALSE(r.error().trace());
+
+    // and are private to the thread that made them
+    auto s = parse("x");
+    ASSERT_TRUE(s.error().trace());
+    const backport::trace_record* other = s.error().trace();
+    std::thread([&] { other = s.error().trace(); }).join();
+    EXPECT_FALSE(other);
+
+    // default-constructed errors have no record
+    EXPECT_FALSE(traced<parse_error>().trace());
+}
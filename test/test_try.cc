@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+
+#include <backport/try.h>
+#include "common.h"
+
+using backport::expected;
+using backport::unexpect;
+using backport::unexpected;
+
+namespace {
+
+expected<int, std::string> parse(const std::string& s) {
+    if (s.empty() || s.find_first_not_of("0123456789")!=std::string::npos) return unexpected("bad: "+s);
+    return std::stoi(s);
+}
+
+expected<int, std::string> sum(const std::string& a, const std::string& b, int& reached) {
+    BACKPORT_TRY(int x, parse(a));
+    ++reached;
+    BACKPORT_TRY(int y, parse(b));
+    ++reached;
+    return x+y;
+}
+
+expected<int, std::string> sum_portable(const std::string& a, const std::string& b, int& reached) {
+    BACKPORT_TRY_PORTABLE_(r1, int x, parse(a));
+    ++reached;
+    BACKPORT_TRY_PORTABLE_(r2, int y, parse(b));
+    ++reached;
+    return x+y;
+}
+
+expected<void, std::string> check(const std::string& a, int& reached) {
+    BACKPORT_TRY_VOID(parse(a));
+    ++reached;
+    expected<void, std::string> v;
+    BACKPORT_TRY_VOID(v);
+    ++reached;
+    return {};
+}
+
+template <typename A, typename B>
+expected<A, B> make(A a) { return a; }
+
+} // anonymous namespace
+
+TEST(try, propagation) {
+    int reached = 0;
+    EXPECT_EQ(7, sum("3", "4", reached));
+    EXPECT_EQ(2, reached);
+
+    reached = 0;
+    EXPECT_EQ(unexpected("bad: x"), sum("x", "4", reached));
+    EXPECT_EQ(0, reached);
+
+    reached = 0;
+    EXPECT_EQ(unexpected("bad: y"), sum("3", "y", reached));
+    EXPECT_EQ(1, reached);
+
+    reached = 0;
+    EXPECT_EQ(7, sum_portable("3", "4", reached));
+    EXPECT_EQ(unexpected("bad: y"), sum_portable("3", "y", reached));
+    EXPECT_EQ(3, reached);
+
+    reached = 0;
+    EXPECT_TRUE(check("1", reached).has_value());
+    EXPECT_EQ(2, reached);
+    EXPECT_EQ(unexpected("bad: z"), check("z", reached));
+    EXPECT_EQ(2, reached);
+
+    // assignment to an existing variable; commas in the expression
+    auto f = []() -> expected<double, long> {
+        double d = 0;
+        BACKPORT_TRY(d, make<double, int>(1.5));
+        BACKPORT_TRY(d, make<double, int>(d*2));
+        return d;
+    };
+    EXPECT_EQ(3., f());
+}
+
+namespace {
+
+using cs = counted<std::string>;
+
+template <typename X>
+expected<cs, cs> pass(X&& x) {
+    BACKPORT_TRY(cs v, std::forward<X>(x));
+    return v;
+}
+
+template <typename X>
+expected<cs, cs> pass_portable(X&& x) {
+    BACKPORT_TRY_PORTABLE_(r, cs v, std::forward<X>(x));
+    return v;
+}
+
+template <typename X>
+expected<void, cs> pass_void(X&& x) {
+    BACKPORT_TRY_VOID(std::forward<X>(x));
+    return {};
+}
+
+// the usual hand-written alternative
+template <typename X>
+expected<cs, cs> pass_by_hand(X&& x) {
+    if (!x) return unexpected(x.error());
+    return *x;
+}
+
+} // anonymous namespace
+
+TEST(try, moves) {
+    using ex = expected<cs, cs>;
+
+    // errors from rvalues: moved into the unexpected, then into the result
+    cs::reset();
+    auto r = pass(ex(unexpect, "err"));
+    EXPECT_EQ("err", r.error().inner);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(2u, cs::n_move_ctor);
+
+    cs::reset();
+    r = pass_portable(ex(unexpect, "err"));
+    EXPECT_EQ("err", r.error().inner);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(2u, cs::n_move_ctor);
+
+    cs::reset();
+    auto v = pass_void(ex(unexpect, "err"));
+    EXPECT_EQ("err", v.error().inner);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(2u, cs::n_move_ctor);
+
+    cs::reset();
+    r = pass_by_hand(ex(unexpect, "err"));
+    EXPECT_EQ(1u, cs::n_copy_ctor);
+
+    // values from rvalues: moved into var (through the value of the
+    // statement expression, if used), then into the result
+    cs::reset();
+    r = pass(ex(std::in_place, "val"));
+    EXPECT_EQ("val", r->inner);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(BACKPORT_TRY_STATEMENT_EXPR? 3u: 2u, cs::n_move_ctor);
+
+    cs::reset();
+    r = pass_portable(ex(std::in_place, "val"));
+    EXPECT_EQ("val", r->inner);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(2u, cs::n_move_ctor);
+
+    // lvalues are copied from, not moved from
+    ex a(std::in_place, "val"), b(unexpect, "err");
+    cs::reset();
+    r = pass(a);
+    EXPECT_EQ("val", a->inner);
+    EXPECT_EQ(1u, cs::n_copy_ctor);
+
+    cs::reset();
+    r = pass(b);
+    EXPECT_EQ("err", b.error().inner);
+    EXPECT_EQ(1u, cs::n_copy_ctor);
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <backport/try_invoke.h>
+#include "common.h"
+
+using backport::expected;
+using backport::unexpect;
+using backport::unexpected;
+
+namespace {
+
+enum class legacy_error { out_of_range, invalid_argument, other };
+
+int legacy_parse(const std::string& s) {
+    std::size_t n = 0;
+    int v = std::stoi(s, &n);
+    if (n!=s.size()) throw std::invalid_argument("trailing characters");
+    return v;
+}
+
+} // anonymous namespace
+
+template <>
+struct backport::exception_translator<legacy_error> {
+    legacy_error operator()() const {
+        try {
+            throw;
+        }
+        catch (const std::out_of_range&) {
+            return legacy_error::out_of_range;
+        }
+        catch (const std::invalid_argument&) {
+            return legacy_error::invalid_argument;
+        }
+        catch (...) {
+            return legacy_error::other;
+        }
+    }
+};
+
+TEST(try_invoke, translation) {
+    using backport::try_invoke;
+
+    auto r = try_invoke<legacy_error>(legacy_parse, "12");
+    static_assert(std::is_same_v<expected<int, legacy_error>, decltype(r)>);
+    EXPECT_EQ(12, r);
+
+    EXPECT_EQ(unexpected(legacy_error::invalid_argument), try_invoke<legacy_error>(legacy_parse, "12x"));
+    EXPECT_EQ(unexpected(legacy_error::invalid_argument), try_invoke<legacy_error>(legacy_parse, "x"));
+    EXPECT_EQ(unexpected(legacy_error::out_of_range), try_invoke<legacy_error>(legacy_parse, "99999999999999999999"));
+    EXPECT_EQ(unexpected(legacy_error::other), try_invoke<legacy_error>([] { throw 3; }));
+
+    // explicit translator
+    auto what = [] {
+        try { throw; }
+        catch (const std::exception& e) { return std::string(e.what()); }
+    };
+    EXPECT_EQ(unexpected(std::string("trailing characters")), backport::try_invoke_with<std::string>(what, legacy_parse, "1 "));
+
+    // void and reference results
+    int n = 0;
+    expected<void, legacy_error> v = try_invoke<legacy_error>([&] { ++n; });
+    EXPECT_TRUE(v.has_value());
+    EXPECT_EQ(1, n);
+
+    auto ref = try_invoke<legacy_error>([&]() -> int& { return n; });
+    static_assert(std::is_same_v<expected<int&, legacy_error>, decltype(ref)>);
+    EXPECT_EQ(&n, &*ref);
+}
+
+TEST(try_invoke, exception_ptr) {
+    using ex = expected<int, std::exception_ptr>;
+
+    ex r = backport::try_invoke<std::exception_ptr>(legacy_parse, "4");
+    EXPECT_EQ(4, backport::value_or_throw(r));
+
+    r = backport::try_invoke<std::exception_ptr>(legacy_parse, "4x");
+    ASSERT_FALSE(r);
+    ASSERT_TRUE(r.error());
+
+    // the original exception is rethrown
+    EXPECT_THROW(backport::value_or_throw(r), std::invalid_argument);
+}
+
+TEST(try_invoke, value_or_throw) {
+    using backport::value_or_throw;
+
+    auto factory = [](legacy_error e) { return std::runtime_error("legacy error "+std::to_string(int(e))); };
+
+    expected<int, legacy_error> a(3), b(unexpect, legacy_error::other);
+    EXPECT_EQ(3, value_or_throw(a, factory));
+    static_assert(std::is_same_v<int&, decltype(value_or_throw(a, factory))>);
+    static_assert(std::is_same_v<int&&, decltype(value_or_throw(std::move(a), factory))>);
+
+    try {
+        value_or_throw(b, factory);
+        FAIL();
+    }
+    catch (const std::runtime_error& e) {
+        EXPECT_EQ(std::string("legacy error 2"), e.what());
+    }
+
+    expected<void, legacy_error> u, w(unexpect, legacy_error::out_of_range);
+    EXPECT_NO_THROW(value_or_throw(u, factory));
+    EXPECT_THROW(value_or_throw(w, factory), std::runtime_error);
+
+    // without a factory, as value()
+    EXPECT_THROW(value_or_throw(b), backport::bad_expected_access<legacy_error>);
+}
+
+TEST(try_invoke, moves) {
+    using cs = counted<std::string>;
+
+    // a prvalue result of the call initializes the value in place
+    cs::reset();
+    auto r = backport::try_invoke<std::exception_ptr>([] { return cs("abc"); });
+    EXPECT_EQ("abc", r->inner);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(0u, cs::n_move_ctor);
+
+    // an lvalue reference result is bound, not copied
+    cs::reset();
+    cs a("def");
+    auto s = backport::try_invoke<std::exception_ptr>([&]() -> cs& { return a; });
+    EXPECT_EQ(&a, &*s);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+    EXPECT_EQ(0u, cs::n_move_ctor);
+
+    // the error is passed to the factory by the value category of x
+    cs::reset();
+    expected<int, cs> x(unexpect, "err");
+    auto factory = [](cs e) { return std::runtime_error(e.inner); };
+    EXPECT_THROW(backport::value_or_throw(std::move(x), factory), std::runtime_error);
+    EXPECT_EQ(0u, cs::n_copy_ctor);
+}